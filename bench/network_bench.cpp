@@ -0,0 +1,137 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <format>
+#include <vector>
+#include <montecarlo/network.hpp>
+
+/*
+=======================================================================
+  NETWORK BENCHMARKS
+=======================================================================
+
+Catch2 benchmarks for the core Network operations, parameterized over
+peer count, injection rate (transactions per 1 s step) and known size
+(steps of traffic already propagated, so known sets and the pending set
+hold backlog_steps x rate ids). Operations that change the network are
+measured on one freshly built network per run, built outside the timed
+region.
+
+  montecarlo_bench                           all benchmarks
+  montecarlo_bench "[broadcast]"             one operation
+  montecarlo_bench --benchmark-samples 20    quicker, noisier
+*/
+
+namespace
+{
+    constexpr unsigned int SEED = 12345;
+    constexpr int NUM_VALIDATORS = 7;
+    constexpr int STEP_MS = 1000;
+    constexpr double BANDWIDTH_KB_PER_MS = 1000.0;
+
+    // Same topology parameters as main, at the given size.
+    void build(Network &net, int peers)
+    {
+        net.set_verbose(false);
+        net.set_fixed_seed(SEED);
+        net.generate_network(peers, false, 3, 12, 10, 500, 1);
+        net.select_validators(NUM_VALIDATORS);
+        net.set_tx_size_config(1, 5);
+    }
+
+    // Propagate backlog_steps steps of traffic at rate, then inject one more step.
+    void fill(Network &net, int rate, int backlog_steps)
+    {
+        for (int s = 0; s < backlog_steps; ++s)
+        {
+            net.inject_transactions(rate);
+            net.broadcast(STEP_MS, BANDWIDTH_KB_PER_MS);
+        }
+        net.inject_transactions(rate);
+    }
+
+    // One network per benchmark run, built and filled before timing starts.
+    std::vector<Network> networks(int runs, int peers, int rate, int backlog_steps)
+    {
+        std::vector<Network> nets(runs);
+        for (auto &net : nets)
+        {
+            build(net, peers);
+            fill(net, rate, backlog_steps);
+        }
+        return nets;
+    }
+}
+
+TEST_CASE("generate_network", "[bench][generate_network]")
+{
+    auto peers = GENERATE(100, 1000, 10000);
+    BENCHMARK(std::format("generate_network peers={}", peers))
+    {
+        Network net;
+        build(net, peers);
+        return net.get_num_peers();
+    };
+}
+
+TEST_CASE("inject_transactions", "[bench][inject_transactions]")
+{
+    auto peers = GENERATE(100, 1000);
+    auto rate = GENERATE(1000, 10000);
+    BENCHMARK_ADVANCED(std::format("inject_transactions peers={} rate={}", peers, rate))(Catch::Benchmark::Chronometer meter)
+    {
+        std::vector<Network> nets(meter.runs());
+        for (auto &net : nets)
+            build(net, peers);
+        meter.measure([&](int i)
+                      { nets[i].inject_transactions(rate); });
+    };
+}
+
+TEST_CASE("broadcast", "[bench][broadcast]")
+{
+    auto peers = GENERATE(100, 1000);
+    auto rate = GENERATE(1000, 10000);
+    auto backlog_steps = GENERATE(0, 2);
+    BENCHMARK_ADVANCED(std::format("broadcast peers={} rate={} known={}", peers, rate, backlog_steps * rate))(Catch::Benchmark::Chronometer meter)
+    {
+        auto nets = networks(meter.runs(), peers, rate, backlog_steps);
+        meter.measure([&](int i)
+                      { nets[i].broadcast(STEP_MS, BANDWIDTH_KB_PER_MS); });
+    };
+}
+
+TEST_CASE("prepare_request", "[bench][prepare_request]")
+{
+    auto peers = GENERATE(100, 1000);
+    auto rate = GENERATE(1000, 10000);
+    auto backlog_steps = GENERATE(1, 2);
+    // prepare_request only replaces the current proposal, so one network serves every run.
+    Network net;
+    build(net, peers);
+    fill(net, rate, backlog_steps);
+    BENCHMARK(std::format("prepare_request peers={} rate={} known={}", peers, rate, backlog_steps * rate))
+    {
+        net.prepare_request(backlog_steps * rate, backlog_steps * rate * 5);
+        return net.get_pending_count();
+    };
+}
+
+TEST_CASE("publish_proposed_transactions", "[bench][publish_proposed_transactions]")
+{
+    // Publishing scales with the pending and proposal sizes, not the peer count; a small
+    // topology keeps the per-run setup (one filled network each) affordable.
+    const int peers = 100;
+    auto rate = GENERATE(1000, 10000);
+    auto backlog_steps = GENERATE(1, 2);
+    BENCHMARK_ADVANCED(std::format("publish_proposed_transactions peers={} rate={} known={}", peers, rate, backlog_steps * rate))(Catch::Benchmark::Chronometer meter)
+    {
+        auto nets = networks(meter.runs(), peers, rate, backlog_steps);
+        for (auto &net : nets)
+            net.prepare_request(backlog_steps * rate, backlog_steps * rate * 5);
+        std::vector<int> simulated_time(meter.runs(), 0), forced(meter.runs(), 0);
+        // Threshold 0 always publishes, so the full publish path is timed.
+        meter.measure([&](int i)
+                      { return nets[i].publish_proposed_transactions(0.0, 15000, simulated_time[i], STEP_MS, forced[i], false); });
+    };
+}
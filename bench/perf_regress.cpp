@@ -0,0 +1,509 @@
+#include <print>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <montecarlo/network.hpp>
+
+/*
+=======================================================================
+  MACRO PERFORMANCE REGRESSION RUNNER
+=======================================================================
+
+Runs canonical end-to-end scenarios several times, records per run
+  - wall time (s),
+  - peak RSS (KB, getrusage of the run),
+  - heap allocations and bytes allocated (counting operator new),
+  - simulated TPS (deterministic: FIXED_SEED),
+  - steps broadcast in parallel (0 for single-threaded scenarios),
+writes them to a JSON file and, given a baseline written the same way,
+flags regressions. Each run executes in a forked child so peak RSS and
+allocation counts belong to that run alone. Everything is local; no
+network access is needed.
+
+  montecarlo_perf [--out FILE] [--baseline FILE] [--repeat N]
+                  [--only SCENARIO] [--threshold PCT]
+
+A metric regresses when its mean grows by more than --threshold percent
+(default 5) AND Welch's t statistic over the runs exceeds T_CRITICAL, so
+noise on a busy machine does not fail the gate but a consistent slowdown
+does. A changed TPS means the simulation output changed and also fails.
+The *_threads4 scenarios repeat a serial one on four broadcast threads:
+their TPS must equal the serial twin's, parallel_steps shows that the
+parallel path ran, and the wall times of the pair give the speedup.
+Exit status: 0 = no regression, 1 = regression or error.
+
+Typical use:
+  montecarlo_perf --out perf_baseline.json             # on the base commit
+  montecarlo_perf --baseline perf_baseline.json        # after the change
+*/
+
+// Allocation counting: every operator new in this process (and forked runs).
+static std::atomic<uint64_t> allocation_count{0};
+static std::atomic<uint64_t> allocation_bytes{0};
+
+void *operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(align);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a))
+        return p;
+    throw std::bad_alloc();
+}
+
+// The default array forms forward to these. Not inlined: GCC would otherwise pair the
+// inlined free() with operator new and warn (-Wmismatched-new-delete).
+__attribute__((noinline)) void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { ::operator delete(p); }
+__attribute__((noinline)) void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t align) noexcept { ::operator delete(p, align); }
+
+namespace
+{
+    constexpr unsigned int FIXED_SEED = 12345;
+    constexpr double T_CRITICAL = 3.0;
+
+    // Scenario: One canonical experiment (topology + run_experiment arguments).
+    struct Scenario
+    {
+        const char *name;
+        int peers;
+        int validators;
+        int total_simulation_ms;
+        int injection_count;
+        int simulation_step_ms;
+        double publish_threshold;
+        int blocktime;
+        double bandwidth_kb_per_ms;
+        int max_transactions;
+        int max_block_size;
+        int threads;
+    };
+
+    // The first two mirror the experiments in src/montecarlo.cpp.
+    const Scenario SCENARIOS[] = {
+        {"main_experiment_1", 30, 7, 60000, 200000, 1000, 95.0, 15000, 1000.0, 4500000, 13500000, 1},
+        {"main_experiment_2", 30, 7, 30000, 100000, 1000, 90.0, 15000, 1000.0, 4500000, 6750000, 1},
+        {"peers_1k", 1000, 50, 30000, 2000, 1000, 95.0, 15000, 1000.0, 45000, 135000, 1},
+        {"peers_10k", 10000, 100, 20000, 200, 1000, 95.0, 15000, 1000.0, 4500, 13500, 1},
+        {"throttled", 30, 7, 30000, 20000, 1000, 95.0, 15000, 0.5, 450000, 1350000, 1},
+        {"main_experiment_1_threads4", 30, 7, 60000, 200000, 1000, 95.0, 15000, 1000.0, 4500000, 13500000, 4},
+        {"throttled_threads4", 30, 7, 30000, 20000, 1000, 95.0, 15000, 0.5, 450000, 1350000, 4},
+    };
+
+    // RunSample: Measurements of one run.
+    struct RunSample
+    {
+        double wall_s = 0.0;
+        double peak_rss_kb = 0.0;
+        double allocations = 0.0;
+        double allocated_bytes = 0.0;
+        double tps = 0.0;
+        double parallel_steps = 0.0;
+    };
+
+    // Metrics compared against the baseline, in JSON field order.
+    const char *const METRICS[] = {"wall_s", "peak_rss_kb", "allocations", "allocated_bytes"};
+
+    double metric(const RunSample &s, size_t m)
+    {
+        const double values[] = {s.wall_s, s.peak_rss_kb, s.allocations, s.allocated_bytes};
+        return values[m];
+    }
+
+    // Run a scenario in a forked child; the child reports through a pipe.
+    bool run_once(const Scenario &sc, RunSample &out)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            std::print("Error: pipe failed: {}\n", std::strerror(errno));
+            return false;
+        }
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            std::print("Error: fork failed: {}\n", std::strerror(errno));
+            return false;
+        }
+        if (pid == 0)
+        {
+            close(fds[0]);
+            uint64_t allocs_before = allocation_count.load(), bytes_before = allocation_bytes.load();
+            auto start = std::chrono::steady_clock::now();
+            RunSample s;
+            {
+                Network network;
+                network.set_verbose(false);
+                network.set_fixed_seed(FIXED_SEED);
+                network.set_known_config(1000000, 20);
+                network.set_threads(sc.threads);
+                network.generate_network(sc.peers, false, 3, 12, 10, 500, 1);
+                network.select_validators(sc.validators);
+                network.set_tx_size_config(1, 5);
+                auto result = network.run_experiment(sc.total_simulation_ms, sc.injection_count, sc.simulation_step_ms,
+                                                     sc.publish_threshold, sc.blocktime, sc.bandwidth_kb_per_ms,
+                                                     sc.max_transactions, sc.max_block_size);
+                s.tps = result.tps;
+                s.parallel_steps = result.parallel_steps;
+            }
+            s.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            s.allocations = static_cast<double>(allocation_count.load() - allocs_before);
+            s.allocated_bytes = static_cast<double>(allocation_bytes.load() - bytes_before);
+            bool ok = write(fds[1], &s, sizeof(s)) == static_cast<ssize_t>(sizeof(s));
+            _exit(ok ? 0 : 1);
+        }
+        close(fds[1]);
+        bool ok = read(fds[0], &out, sizeof(out)) == static_cast<ssize_t>(sizeof(out));
+        close(fds[0]);
+        int status = 0;
+        rusage usage{};
+        wait4(pid, &status, 0, &usage);
+        if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::print("Error: scenario {} run failed (status {}).\n", sc.name, status);
+            return false;
+        }
+        out.peak_rss_kb = static_cast<double>(usage.ru_maxrss); // KB on Linux.
+        return true;
+    }
+
+    // Stats: Mean, sample standard deviation and count of one metric.
+    struct Stats
+    {
+        double mean = 0.0;
+        double stddev = 0.0;
+        size_t n = 0;
+
+        static Stats of(const std::vector<double> &v)
+        {
+            Stats s;
+            s.n = v.size();
+            if (s.n == 0)
+                return s;
+            for (double x : v)
+                s.mean += x;
+            s.mean /= s.n;
+            if (s.n > 1)
+            {
+                double ss = 0.0;
+                for (double x : v)
+                    ss += (x - s.mean) * (x - s.mean);
+                s.stddev = std::sqrt(ss / (s.n - 1));
+            }
+            return s;
+        }
+    };
+
+    // Welch's t statistic for current vs baseline (positive = current larger).
+    double welch_t(const Stats &base, const Stats &cur)
+    {
+        double se = std::sqrt(base.stddev * base.stddev / base.n + cur.stddev * cur.stddev / cur.n);
+        double diff = cur.mean - base.mean;
+        if (se == 0.0)
+            return diff == 0.0 ? 0.0 : std::copysign(INFINITY, diff);
+        return diff / se;
+    }
+
+    // ScenarioResults: name -> metric name -> per-run values (plus "tps" and "parallel_steps").
+    using ScenarioResults = std::map<std::string, std::map<std::string, std::vector<double>>>;
+
+    bool write_json(const std::string &path, const ScenarioResults &results)
+    {
+        std::FILE *f = std::fopen(path.c_str(), "w");
+        if (!f)
+        {
+            std::print("Error opening {} for writing.\n", path);
+            return false;
+        }
+        std::fprintf(f, "{\n  \"version\": 1,\n  \"scenarios\": {");
+        bool first_scenario = true;
+        for (const auto &[name, metrics] : results)
+        {
+            std::fprintf(f, "%s\n    \"%s\": {", first_scenario ? "" : ",", name.c_str());
+            first_scenario = false;
+            bool first_metric = true;
+            for (const auto &[metric_name, values] : metrics)
+            {
+                std::fprintf(f, "%s\n      \"%s\": [", first_metric ? "" : ",", metric_name.c_str());
+                first_metric = false;
+                for (size_t i = 0; i < values.size(); ++i)
+                    std::fprintf(f, "%s%.17g", i ? ", " : "", values[i]);
+                std::fprintf(f, "]");
+            }
+            std::fprintf(f, "\n    }");
+        }
+        std::fprintf(f, "\n  }\n}\n");
+        return std::fclose(f) == 0;
+    }
+
+    // Reader for the file write_json produces: {"version": 1, "scenarios": {name: {metric: [numbers]}}}.
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(std::string text) : s(std::move(text)) {}
+
+        bool parse(ScenarioResults &out)
+        {
+            if (!expect('{'))
+                return false;
+            do
+            {
+                std::string key;
+                if (!string(key) || !expect(':'))
+                    return false;
+                if (key == "scenarios")
+                {
+                    if (!scenarios(out))
+                        return false;
+                }
+                else if (!number_value())
+                    return false;
+            } while (accept(','));
+            return expect('}');
+        }
+
+    private:
+        bool scenarios(ScenarioResults &out)
+        {
+            if (!expect('{'))
+                return false;
+            if (accept('}'))
+                return true;
+            do
+            {
+                std::string name;
+                if (!string(name) || !expect(':') || !expect('{'))
+                    return false;
+                do
+                {
+                    std::string metric_name;
+                    if (!string(metric_name) || !expect(':') || !expect('['))
+                        return false;
+                    auto &values = out[name][metric_name];
+                    if (!accept(']'))
+                    {
+                        do
+                        {
+                            double v;
+                            if (!number(v))
+                                return false;
+                            values.push_back(v);
+                        } while (accept(','));
+                        if (!expect(']'))
+                            return false;
+                    }
+                } while (accept(','));
+                if (!expect('}'))
+                    return false;
+            } while (accept(','));
+            return expect('}');
+        }
+
+        void skip_space()
+        {
+            while (pos < s.size() && std::isspace(static_cast<unsigned char>(s[pos])))
+                pos++;
+        }
+
+        bool accept(char c)
+        {
+            skip_space();
+            if (pos < s.size() && s[pos] == c)
+            {
+                pos++;
+                return true;
+            }
+            return false;
+        }
+
+        bool expect(char c)
+        {
+            if (accept(c))
+                return true;
+            std::print("Error: baseline JSON: expected '{}' at offset {}.\n", c, pos);
+            return false;
+        }
+
+        bool string(std::string &out)
+        {
+            if (!expect('"'))
+                return false;
+            size_t end = s.find('"', pos);
+            if (end == std::string::npos)
+                return false;
+            out = s.substr(pos, end - pos);
+            pos = end + 1;
+            return true;
+        }
+
+        bool number(double &v)
+        {
+            skip_space();
+            char *end = nullptr;
+            v = std::strtod(s.c_str() + pos, &end);
+            if (end == s.c_str() + pos)
+            {
+                std::print("Error: baseline JSON: expected a number at offset {}.\n", pos);
+                return false;
+            }
+            pos = end - s.c_str();
+            return true;
+        }
+
+        bool number_value()
+        {
+            double ignored;
+            return number(ignored);
+        }
+
+        std::string s;
+        size_t pos = 0;
+    };
+
+    bool read_json(const std::string &path, ScenarioResults &out)
+    {
+        std::FILE *f = std::fopen(path.c_str(), "r");
+        if (!f)
+        {
+            std::print("Error opening baseline {}.\n", path);
+            return false;
+        }
+        std::string text;
+        char buf[4096];
+        size_t n;
+        while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0)
+            text.append(buf, n);
+        std::fclose(f);
+        return JsonReader(std::move(text)).parse(out);
+    }
+
+    // Print the comparison table; returns false if anything regressed.
+    bool compare(const ScenarioResults &baseline, const ScenarioResults &current, double threshold_pct)
+    {
+        bool ok = true;
+        std::print("{:<20} {:<16} {:>14} {:>14} {:>9} {:>8}  {}\n", "scenario", "metric", "baseline", "current", "change", "t", "verdict");
+        for (const auto &[name, metrics] : current)
+        {
+            auto base_it = baseline.find(name);
+            if (base_it == baseline.end())
+            {
+                std::print("{:<20} (not in baseline)\n", name);
+                continue;
+            }
+            for (const char *m : METRICS)
+            {
+                auto b = base_it->second.find(m), c = metrics.find(m);
+                if (b == base_it->second.end() || c == metrics.end())
+                    continue;
+                Stats bs = Stats::of(b->second), cs = Stats::of(c->second);
+                double change = bs.mean != 0.0 ? (cs.mean - bs.mean) / bs.mean * 100.0 : 0.0;
+                double t = welch_t(bs, cs);
+                const char *verdict = "ok";
+                if (change > threshold_pct && t > T_CRITICAL)
+                {
+                    verdict = "REGRESSION";
+                    ok = false;
+                }
+                else if (change < -threshold_pct && t < -T_CRITICAL)
+                    verdict = "improved";
+                std::print("{:<20} {:<16} {:>14.4g} {:>14.4g} {:>+8.2f}% {:>8.2f}  {}\n", name, m, bs.mean, cs.mean, change, t, verdict);
+            }
+            auto b = base_it->second.find("tps"), c = metrics.find("tps");
+            if (b != base_it->second.end() && c != metrics.end() && !b->second.empty() && !c->second.empty() &&
+                std::fabs(c->second[0] - b->second[0]) > 1e-9 * std::max(1.0, std::fabs(b->second[0])))
+            {
+                std::print("{:<20} {:<16} {:>14.4f} {:>14.4f}  RESULT CHANGED\n", name, "tps", b->second[0], c->second[0]);
+                ok = false;
+            }
+        }
+        return ok;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string out_path = "perf_results.json";
+    std::string baseline_path;
+    std::string only;
+    int repeat = 5;
+    double threshold_pct = 5.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--out" && has_value)
+            out_path = argv[++i];
+        else if (arg == "--baseline" && has_value)
+            baseline_path = argv[++i];
+        else if (arg == "--only" && has_value)
+            only = argv[++i];
+        else if (arg == "--repeat" && has_value)
+            repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threshold" && has_value)
+            threshold_pct = std::atof(argv[++i]);
+        else
+        {
+            std::print("Usage: {} [--out FILE] [--baseline FILE] [--repeat N] [--only SCENARIO] [--threshold PCT]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    ScenarioResults baseline;
+    if (!baseline_path.empty() && !read_json(baseline_path, baseline))
+        return 1;
+
+    ScenarioResults results;
+    for (const auto &sc : SCENARIOS)
+    {
+        if (!only.empty() && only != sc.name)
+            continue;
+        auto &metrics = results[sc.name];
+        for (int r = 0; r < repeat; ++r)
+        {
+            RunSample s;
+            if (!run_once(sc, s))
+                return 1;
+            for (size_t m = 0; m < std::size(METRICS); ++m)
+                metrics[METRICS[m]].push_back(metric(s, m));
+            metrics["tps"].push_back(s.tps);
+            metrics["parallel_steps"].push_back(s.parallel_steps);
+            std::print("{} run {}/{}: {:.3f} s, peak RSS {:.0f} KB, {:.0f} allocations, TPS {:.2f}, {:.0f} parallel steps\n",
+                       sc.name, r + 1, repeat, s.wall_s, s.peak_rss_kb, s.allocations, s.tps, s.parallel_steps);
+        }
+    }
+    if (results.empty())
+    {
+        std::print("Error: no scenario named {}.\n", only);
+        return 1;
+    }
+    if (!write_json(out_path, results))
+        return 1;
+    std::print("Wrote {}.\n", out_path);
+
+    if (baseline_path.empty())
+        return 0;
+    return compare(baseline, results, threshold_pct) ? 0 : 1;
+}
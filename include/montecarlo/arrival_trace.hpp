@@ -0,0 +1,273 @@
+#ifndef ARRIVAL_TRACE_HPP
+#define ARRIVAL_TRACE_HPP
+
+#include <print>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <montecarlo/workload.hpp>
+
+/*
+=======================================================================
+  ARRIVAL TRACES
+=======================================================================
+
+Recorded transaction arrivals (timestamp, size, origin peer) stored as a
+binary columnar file that is memory-mapped and streamed, never loaded:
+
+  offset 0   header (64 bytes)
+               char     magic[8]   "MCTRACE\0"
+               uint32   version    ARRIVAL_TRACE_VERSION
+               uint32   reserved
+               uint64   count      number of rows
+               uint64   timestamp_offset, size_offset, origin_offset
+               (zero padding to 64 bytes)
+  column     uint32 timestamp_ms[count]  (ascending; replay stops at the
+                                          first row out of order)
+  column     uint16 size_kb[count]
+  column     uint32 origin_peer[count]
+
+Every column starts on a 64-byte boundary. Values are little-endian.
+*/
+
+constexpr char ARRIVAL_TRACE_MAGIC[8] = {'M', 'C', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr uint32_t ARRIVAL_TRACE_VERSION = 1;
+
+struct ArrivalTraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t timestamp_offset;
+    uint64_t size_offset;
+    uint64_t origin_offset;
+    uint8_t padding[16];
+};
+static_assert(sizeof(ArrivalTraceHeader) == 64);
+
+inline uint64_t align64(uint64_t offset)
+{
+    return (offset + 63) & ~uint64_t(63);
+}
+
+// write_arrival_trace: Write columns to path. Returns false (and prints why) on failure.
+inline bool write_arrival_trace(const std::string &path, const std::vector<uint32_t> &timestamp_ms,
+                                const std::vector<uint16_t> &size_kb, const std::vector<uint32_t> &origin_peer)
+{
+    if (timestamp_ms.size() != size_kb.size() || timestamp_ms.size() != origin_peer.size())
+    {
+        std::print("Error: trace columns have different lengths.\n");
+        return false;
+    }
+    ArrivalTraceHeader header{};
+    std::memcpy(header.magic, ARRIVAL_TRACE_MAGIC, sizeof(header.magic));
+    header.version = ARRIVAL_TRACE_VERSION;
+    header.count = timestamp_ms.size();
+    header.timestamp_offset = align64(sizeof(header));
+    header.size_offset = align64(header.timestamp_offset + header.count * sizeof(uint32_t));
+    header.origin_offset = align64(header.size_offset + header.count * sizeof(uint16_t));
+    uint64_t file_size = header.origin_offset + header.count * sizeof(uint32_t);
+
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+    {
+        std::print("Error opening trace file {} for writing.\n", path);
+        return false;
+    }
+    std::vector<char> image(file_size, 0);
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + header.timestamp_offset, timestamp_ms.data(), header.count * sizeof(uint32_t));
+    std::memcpy(image.data() + header.size_offset, size_kb.data(), header.count * sizeof(uint16_t));
+    std::memcpy(image.data() + header.origin_offset, origin_peer.data(), header.count * sizeof(uint32_t));
+    bool ok = std::fwrite(image.data(), 1, image.size(), f) == image.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok)
+        std::print("Error writing trace file {}.\n", path);
+    return ok;
+}
+
+// ArrivalTrace: Read-only memory mapping of a trace file. Columns point straight into
+// the mapping; pages are faulted in as the cursor advances and released behind it.
+class ArrivalTrace
+{
+public:
+    ArrivalTrace() = default;
+    ArrivalTrace(const ArrivalTrace &) = delete;
+    ArrivalTrace &operator=(const ArrivalTrace &) = delete;
+    ~ArrivalTrace() { close(); }
+
+    bool open(const std::string &path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            std::print("Error opening trace file {}.\n", path);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ArrivalTraceHeader))
+        {
+            std::print("Error: trace file {} is too small.\n", path);
+            ::close(fd);
+            return false;
+        }
+        mapped_size = static_cast<size_t>(st.st_size);
+        void *p = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+        {
+            std::print("Error mapping trace file {}.\n", path);
+            mapped_size = 0;
+            return false;
+        }
+        base = static_cast<const uint8_t *>(p);
+        madvise(p, mapped_size, MADV_SEQUENTIAL);
+
+        const auto *h = reinterpret_cast<const ArrivalTraceHeader *>(base);
+        if (std::memcmp(h->magic, ARRIVAL_TRACE_MAGIC, sizeof(h->magic)) != 0 || h->version != ARRIVAL_TRACE_VERSION ||
+            h->timestamp_offset + h->count * sizeof(uint32_t) > mapped_size ||
+            h->size_offset + h->count * sizeof(uint16_t) > mapped_size ||
+            h->origin_offset + h->count * sizeof(uint32_t) > mapped_size)
+        {
+            std::print("Error: {} is not a valid version {} arrival trace.\n", path, ARRIVAL_TRACE_VERSION);
+            close();
+            return false;
+        }
+        rows = h->count;
+        timestamps = reinterpret_cast<const uint32_t *>(base + h->timestamp_offset);
+        sizes = reinterpret_cast<const uint16_t *>(base + h->size_offset);
+        origins = reinterpret_cast<const uint32_t *>(base + h->origin_offset);
+        return true;
+    }
+
+    void close()
+    {
+        if (base)
+            munmap(const_cast<uint8_t *>(base), mapped_size);
+        base = nullptr;
+        mapped_size = 0;
+        rows = 0;
+        released = 0;
+    }
+
+    bool is_open() const { return base != nullptr; }
+    uint64_t count() const { return rows; }
+    uint32_t timestamp_ms(uint64_t i) const { return timestamps[i]; }
+    uint16_t size_kb(uint64_t i) const { return sizes[i]; }
+    uint32_t origin_peer(uint64_t i) const { return origins[i]; }
+
+    // First row with timestamp >= t, searching from row `from`.
+    uint64_t lower_bound(uint64_t from, uint32_t t) const
+    {
+        uint64_t lo = from, hi = rows;
+        while (lo < hi)
+        {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (timestamps[mid] < t)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    // Start streaming again from row 0: a new replay faults its rows back in, so releasing
+    // restarts from the top.
+    void rewind()
+    {
+        released = 0;
+    }
+
+    // Drop mapped pages of rows before `row` so resident memory stays bounded while streaming.
+    void release_before(uint64_t row)
+    {
+        const long page = sysconf(_SC_PAGESIZE);
+        release_column(timestamps, row, sizeof(uint32_t), page);
+        release_column(sizes, row, sizeof(uint16_t), page);
+        release_column(origins, row, sizeof(uint32_t), page);
+        released = row;
+    }
+
+private:
+    void release_column(const void *column, uint64_t row, size_t width, long page)
+    {
+        uintptr_t from = reinterpret_cast<uintptr_t>(column) + released * width;
+        uintptr_t to = reinterpret_cast<uintptr_t>(column) + row * width;
+        from = (from + page - 1) / page * page;
+        to = to / page * page;
+        if (to > from)
+            madvise(reinterpret_cast<void *>(from), to - from, MADV_DONTNEED);
+    }
+
+    const uint8_t *base = nullptr;
+    size_t mapped_size = 0;
+    uint64_t rows = 0;
+    uint64_t released = 0;
+    const uint32_t *timestamps = nullptr;
+    const uint16_t *sizes = nullptr;
+    const uint32_t *origins = nullptr;
+};
+
+// TraceWorkload: Replays an ArrivalTrace. Trace time is shifted so the first row lands
+// at t = 0; origin peers beyond the simulated network wrap around (origin % num_peers).
+// Steps must be requested in increasing time order. Rows are checked for ascending
+// timestamps as they stream; at the first row out of order the replay reports it and
+// injects nothing more (ok() turns false).
+class TraceWorkload : public Workload
+{
+public:
+    explicit TraceWorkload(ArrivalTrace &trace) : trace(trace)
+    {
+        origin_ms = trace.count() > 0 ? trace.timestamp_ms(0) : 0;
+        trace.rewind();
+    }
+
+    void generate(const WorkloadContext &ctx, int start_ms, int step_ms, InjectionBatch &batch) override
+    {
+        batch.resize(0);
+        if (!in_order)
+            return;
+        uint64_t end = trace.lower_bound(cursor, origin_ms + static_cast<uint32_t>(start_ms + step_ms));
+        for (uint64_t row = cursor; row < end; ++row)
+        {
+            if (trace.timestamp_ms(row) < previous_ms)
+            {
+                std::print("Error: arrival trace row {} goes back in time ({} ms after {} ms).\n", row,
+                           trace.timestamp_ms(row), previous_ms);
+                in_order = false;
+                return;
+            }
+            previous_ms = trace.timestamp_ms(row);
+        }
+        uint64_t begin = trace.lower_bound(cursor, origin_ms + static_cast<uint32_t>(start_ms));
+        int n = static_cast<int>(end - begin);
+        batch.resize(n);
+        for (int i = 0; i < n; ++i)
+        {
+            batch.size_kb[i] = trace.size_kb(begin + i);
+            batch.seed[i] = static_cast<int>(trace.origin_peer(begin + i) % static_cast<uint32_t>(ctx.num_peers));
+        }
+        cursor = end;
+        trace.release_before(cursor);
+    }
+
+    bool finished() const { return !in_order || cursor >= trace.count(); }
+    bool ok() const { return in_order; }
+
+private:
+    ArrivalTrace &trace;
+    uint32_t origin_ms = 0;
+    uint64_t cursor = 0;
+    uint32_t previous_ms = 0;
+    bool in_order = true;
+};
+
+#endif // ARRIVAL_TRACE_HPP
@@ -0,0 +1,117 @@
+#ifndef COW_VECTOR_HPP
+#define COW_VECTOR_HPP
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+/*
+=======================================================================
+  COPY-ON-WRITE CHUNKED VECTOR
+=======================================================================
+
+Append-mostly array split into fixed chunks of 2^CHUNK_BITS elements held
+by shared_ptr. Copying a CowVector copies only the chunk pointers; a
+chunk is duplicated the first time a copy writes to it (mut, or an append
+into a shared tail chunk). Network::fork relies on this so branches share
+the per-transaction arrays of everything injected before the fork and
+only pay for the chunks they touch afterwards.
+
+Reads are one extra indirection over std::vector. Writers check the
+chunk's use count; a copy that becomes the only owner writes in place.
+*/
+
+template <typename T, int CHUNK_BITS = 16>
+class CowVector
+{
+public:
+    static constexpr size_t CHUNK = size_t{1} << CHUNK_BITS;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const T &operator[](size_t i) const
+    {
+        return chunks[i >> CHUNK_BITS][i & (CHUNK - 1)];
+    }
+
+    // Writable element i; copies its chunk first if another CowVector shares it.
+    T &mut(size_t i)
+    {
+        return own_chunk(i >> CHUNK_BITS)[i & (CHUNK - 1)];
+    }
+
+    // Append n copies of value.
+    void append(size_t n, const T &value)
+    {
+        while (n > 0)
+        {
+            size_t k = std::min(n, reserve_tail());
+            T *tail = own_chunk(count >> CHUNK_BITS).get() + (count & (CHUNK - 1));
+            std::fill(tail, tail + k, value);
+            count += k;
+            n -= k;
+        }
+    }
+
+    // Append values[0 .. n).
+    void append(const T *values, size_t n)
+    {
+        while (n > 0)
+        {
+            size_t k = std::min(n, reserve_tail());
+            T *tail = own_chunk(count >> CHUNK_BITS).get() + (count & (CHUNK - 1));
+            std::copy(values, values + k, tail);
+            count += k;
+            values += k;
+            n -= k;
+        }
+    }
+
+    void clear()
+    {
+        chunks.clear();
+        count = 0;
+    }
+
+    std::vector<T> to_vector() const
+    {
+        std::vector<T> out;
+        out.reserve(count);
+        for (size_t c = 0; c < chunks.size(); ++c)
+            out.insert(out.end(), chunks[c].get(), chunks[c].get() + std::min(CHUNK, count - c * CHUNK));
+        return out;
+    }
+
+private:
+    using Chunk = std::shared_ptr<T[]>;
+
+    // Room left in the tail chunk, adding an empty chunk if the tail is full.
+    size_t reserve_tail()
+    {
+        if (count == chunks.size() * CHUNK)
+            chunks.push_back(std::make_shared<T[]>(CHUNK));
+        return chunks.size() * CHUNK - count;
+    }
+
+    Chunk &own_chunk(size_t c)
+    {
+        Chunk &chunk = chunks[c];
+        if (chunk.use_count() > 1)
+        {
+            Chunk copy = std::make_shared<T[]>(CHUNK);
+            std::copy(chunk.get(), chunk.get() + CHUNK, copy.get());
+            chunk = std::move(copy);
+        }
+        else
+            std::atomic_thread_fence(std::memory_order_acquire); // Pairs with other owners' release on drop.
+        return chunk;
+    }
+
+    std::vector<Chunk> chunks;
+    size_t count = 0;
+};
+
+#endif // COW_VECTOR_HPP
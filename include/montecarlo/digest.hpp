@@ -0,0 +1,44 @@
+#ifndef DIGEST_HPP
+#define DIGEST_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <format>
+#include <string>
+
+/*
+=======================================================================
+  RUN DIGEST
+=======================================================================
+
+64-bit FNV-1a over a stream of integers: a compact fingerprint of a run
+(per-step pending and published counts, final known sets) used to check
+that an optimized engine reproduces the reference results exactly. Equal
+digests mean identical streams with overwhelming probability; any
+difference in any step or any known bit changes the digest.
+*/
+
+class RunDigest
+{
+public:
+    static constexpr uint64_t OFFSET_BASIS = 0xcbf29ce484222325ULL;
+    static constexpr uint64_t PRIME = 0x100000001b3ULL;
+
+    void add(uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            hash ^= (v >> (8 * i)) & 0xff;
+            hash *= PRIME;
+        }
+    }
+
+    void clear() { hash = OFFSET_BASIS; }
+    uint64_t value() const { return hash; }
+    std::string hex() const { return std::format("{:016x}", hash); }
+
+private:
+    uint64_t hash = OFFSET_BASIS;
+};
+
+#endif // DIGEST_HPP
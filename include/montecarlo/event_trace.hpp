@@ -0,0 +1,236 @@
+#ifndef EVENT_TRACE_HPP
+#define EVENT_TRACE_HPP
+
+#include <print>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <montecarlo/profiler.hpp>
+
+/*
+=======================================================================
+  EVENT TRACE (Chrome trace event JSON)
+=======================================================================
+
+Optional record of what the simulation did, viewable in Perfetto
+(ui.perfetto.dev) or chrome://tracing:
+
+  - "Simulation time" process: one track per peer, with instant events
+    for injections (on the seed), deliveries (on the receiver, with the
+    sender and link delay), proposals (on the validator), and global
+    instants for publishes and forced publishes. Timestamps are simulated
+    ms (shown as us x 1000).
+  - "Wall time" process: one track per recording thread, with a slice
+    for every inject / broadcast / prepare_request / publish call.
+
+Each thread appends to its own fixed-capacity ring buffer, so recording
+is a few stores and never allocates or locks after the first event on a
+thread. When a ring fills, the oldest events are overwritten: the file
+holds the last ring_capacity events per thread, and memory stays bounded
+however long the run.
+*/
+
+class EventTracer
+{
+public:
+    enum class Kind : uint8_t
+    {
+        Inject,
+        Deliver,
+        Propose,
+        Publish,
+        ForcedPublish,
+        PhaseSpan
+    };
+
+    // TraceEvent: One record; field meaning depends on kind.
+    struct TraceEvent
+    {
+        int64_t ts_us;  // Simulated time (x1000) or wall time since construction.
+        int64_t dur_us; // PhaseSpan: duration. ForcedPublish: stall length.
+        int32_t track;  // Peer (simulation events) or unused (wall events, track = thread).
+        int32_t tx;     // Tx id, or tx count for Propose / Publish.
+        int32_t arg;    // Deliver: sender. PhaseSpan: phase index.
+        int32_t delay;  // Deliver: link delay in ms.
+        Kind kind;
+    };
+
+    explicit EventTracer(size_t ring_capacity = 1 << 20)
+        : capacity(ring_capacity), id(next_id()), wall_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    EventTracer(const EventTracer &) = delete;
+    EventTracer &operator=(const EventTracer &) = delete;
+
+    // Display name for a peer's simulation-time track.
+    void set_track_name(int track, std::string name)
+    {
+        if (track >= static_cast<int>(track_names.size()))
+            track_names.resize(track + 1);
+        track_names[track] = std::move(name);
+    }
+
+    void inject(int sim_ms, int seed, int tx)
+    {
+        local().push({sim_ms * 1000LL, 0, seed, tx, 0, 0, Kind::Inject});
+    }
+
+    void deliver(int sim_ms, int sender, int receiver, int tx, int delay_ms)
+    {
+        local().push({sim_ms * 1000LL, 0, receiver, tx, sender, delay_ms, Kind::Deliver});
+    }
+
+    void propose(int sim_ms, int validator, int tx_count)
+    {
+        local().push({sim_ms * 1000LL, 0, validator, tx_count, 0, 0, Kind::Propose});
+    }
+
+    void publish(int sim_ms, int tx_count, bool forced, int stall_ms)
+    {
+        local().push({sim_ms * 1000LL, stall_ms * 1000LL, 0, tx_count, 0, 0, forced ? Kind::ForcedPublish : Kind::Publish});
+    }
+
+    // Span: Records a wall-time slice for the enclosing scope. tracer may be null.
+    class Span
+    {
+    public:
+        Span(EventTracer *tracer, Phase phase)
+            : tracer(tracer), phase(phase), start(tracer ? tracer->wall_us() : 0) {}
+        ~Span()
+        {
+            if (tracer)
+                tracer->local().push({start, tracer->wall_us() - start, 0, 0, static_cast<int32_t>(phase), 0, Kind::PhaseSpan});
+        }
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        EventTracer *tracer;
+        Phase phase;
+        int64_t start;
+    };
+
+    // Write all rings as Chrome trace event JSON. Call when no thread is recording.
+    bool write_json(const std::string &path) const
+    {
+        std::FILE *f = std::fopen(path.c_str(), "w");
+        if (!f)
+        {
+            std::print("Error opening trace file {}.\n", path);
+            return false;
+        }
+        std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        std::fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Simulation time\"}},\n", SIM_PID);
+        std::fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Wall time\"}}", WALL_PID);
+        for (size_t t = 0; t < track_names.size(); ++t)
+            if (!track_names[t].empty())
+                std::fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                             SIM_PID, t, track_names[t].c_str());
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (size_t r = 0; r < rings.size(); ++r)
+        {
+            const Ring &ring = *rings[r];
+            uint64_t first = ring.written > capacity ? ring.written - capacity : 0;
+            if (first > 0)
+                std::print("Trace ring {} overflowed: kept the last {} of {} events.\n", r, capacity, ring.written);
+            for (uint64_t i = first; i < ring.written; ++i)
+                write_event(f, ring.events[i % capacity], r);
+        }
+        std::fprintf(f, "\n]}\n");
+        bool ok = std::fclose(f) == 0;
+        if (!ok)
+            std::print("Error writing trace file {}.\n", path);
+        return ok;
+    }
+
+private:
+    static constexpr int SIM_PID = 1;
+    static constexpr int WALL_PID = 2;
+
+    struct Ring
+    {
+        std::vector<TraceEvent> events;
+        uint64_t written = 0;
+
+        void push(const TraceEvent &e)
+        {
+            events[written++ % events.size()] = e;
+        }
+    };
+
+    static uint64_t next_id()
+    {
+        static std::atomic<uint64_t> ids{0};
+        return ++ids;
+    }
+
+    int64_t wall_us() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wall_start).count();
+    }
+
+    // This thread's ring, created on first use. The thread-local cache is keyed by tracer id,
+    // not address, so a new tracer at a reused address never sees a stale ring.
+    Ring &local()
+    {
+        struct Cache
+        {
+            uint64_t tracer = 0;
+            Ring *ring = nullptr;
+        };
+        static thread_local Cache cache;
+        if (cache.tracer != id)
+        {
+            auto ring = std::make_unique<Ring>();
+            ring->events.resize(capacity);
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            rings.push_back(std::move(ring));
+            cache = Cache{id, rings.back().get()};
+        }
+        return *cache.ring;
+    }
+
+    static void write_event(std::FILE *f, const TraceEvent &e, size_t thread)
+    {
+        switch (e.kind)
+        {
+        case Kind::Inject:
+            std::fprintf(f, ",\n{\"name\":\"inject\",\"cat\":\"tx\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"args\":{\"tx\":%d}}",
+                         SIM_PID, e.track, static_cast<long long>(e.ts_us), e.tx);
+            break;
+        case Kind::Deliver:
+            std::fprintf(f, ",\n{\"name\":\"deliver\",\"cat\":\"tx\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"args\":{\"tx\":%d,\"from\":%d,\"delay_ms\":%d}}",
+                         SIM_PID, e.track, static_cast<long long>(e.ts_us), e.tx, e.arg, e.delay);
+            break;
+        case Kind::Propose:
+            std::fprintf(f, ",\n{\"name\":\"propose\",\"cat\":\"block\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"args\":{\"txs\":%d}}",
+                         SIM_PID, e.track, static_cast<long long>(e.ts_us), e.tx);
+            break;
+        case Kind::Publish:
+        case Kind::ForcedPublish:
+            std::fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"block\",\"ph\":\"i\",\"s\":\"g\",\"pid\":%d,\"ts\":%lld,\"args\":{\"txs\":%d,\"stall_ms\":%lld}}",
+                         e.kind == Kind::Publish ? "publish" : "forced publish", SIM_PID, static_cast<long long>(e.ts_us), e.tx,
+                         static_cast<long long>(e.dur_us / 1000));
+            break;
+        case Kind::PhaseSpan:
+            std::fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":%d,\"tid\":%zu,\"ts\":%lld,\"dur\":%lld}",
+                         PHASE_NAMES[e.arg], WALL_PID, thread, static_cast<long long>(e.ts_us), static_cast<long long>(e.dur_us));
+            break;
+        }
+    }
+
+    size_t capacity;
+    uint64_t id;
+    std::chrono::steady_clock::time_point wall_start;
+    std::vector<std::string> track_names;
+    mutable std::mutex rings_mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+};
+
+#endif // EVENT_TRACE_HPP
@@ -0,0 +1,537 @@
+#ifndef FLUID_HPP
+#define FLUID_HPP
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <montecarlo/histogram.hpp>
+#include <montecarlo/quantile_sketch.hpp>
+#include <montecarlo/steady_state.hpp>
+
+/*
+=======================================================================
+  FLUID (FLOW-LEVEL) APPROXIMATION
+=======================================================================
+
+The exact engine tracks every transaction and every delivery attempt,
+so its cost grows with TPS. For capacity estimates at extreme rates the
+fluid model drops individual transactions: what is injected in one step
+at one origin group (a contiguous chunk of the seed peers) is a bucket,
+a pending volume of transactions plus, per peer, the fraction of that
+volume the peer knows. Its cost depends on the topology and on how many
+buckets are still spreading, not on the number of transactions.
+
+Propagation. A link with delay d takes c = max(1, ceil(d / step)) steps,
+so the model keeps the last few steps of known fractions per bucket. Each
+link u -> v also remembers o_uv, the fraction of the bucket it has sent so
+far. In step s the link offers what u knew c steps earlier and has not
+sent yet, the increment x_u(s-c) - x_u(s-c-1) plus any backlog held back
+by throttling, and sends scale_u of it:
+
+  sent_uv = scale_u * (x_u(s - c_uv) - o_uv),   o_uv += sent_uv
+
+A link never offers the same part of the bucket twice. Treating links as
+independent, v misses a tx only if it missed it before and none of the
+links sent it; a send is new to v in proportion to what that link had not
+sent before, so
+
+  x_v(s) = 1 - (1 - x_v(s-1)) * prod_u (1 - sent_uv / (1 - o_uv before))
+
+and once a link has sent a sender's whole bucket (o_uv = 1), v knows it.
+scale_u in [0, 1] throttles sender u: like the exact engine, which walks
+pending transactions oldest first, senders serve buckets in injection
+order, and scale_u is what is left of u's bandwidth x step against its
+demand for this bucket (what its links offer that each neighbour misses).
+Only the gains are charged. With one seed per origin group and no
+throttling every x is 0 or 1 and this is the exact engine's step-level
+propagation. A gain lands at the earliest arrival among the links that
+sent to v, at the start of the step for a link sending throttled backlog
+(a retried attempt in the exact engine).
+
+Blocks. Mirrors run_experiment: a random validator proposes a uniform
+share of the volume it knows, capped by max_transactions and
+max_block_size at the mean tx size; a validator's coverage of the
+proposal assumes known sets are nested (min(1, x_w / x_proposer)), and
+publication, the publish-attempt counter and forced publishing follow
+the exact engine. Publishing removes the proposed volume, and what the
+proposer knew of it, from the bucket.
+
+A bucket reaches a coverage level when its known fractions summed over
+peers (or validators), rounded to whole peers, cross it, at the arrival
+of the gain that crossed it; with several seeds per group the fractions
+only approach 1, so an unrounded 100% level would lag by a step.
+Inclusion latency is per published volume. Steps always have the full
+simulation_step_ms length, and only fixed injection per step is
+modelled. Network::calibrate_fluid runs both engines side by side.
+*/
+
+// FluidConfig: Resolution of the fluid model.
+struct FluidConfig
+{
+    int origin_groups = 64; // Seed peers are split into at most this many origin groups.
+};
+
+// FluidParams: One experiment, with the same meaning as in Network::run_experiment.
+struct FluidParams
+{
+    int total_simulation_ms = 0;
+    int injection_count = 0;
+    int simulation_step_ms = 1000;
+    double publish_threshold = 95.0;
+    int blocktime = 15000;
+    double bandwidth_kb_per_ms = 0.0;
+    int max_transactions = 0;
+    int max_block_size = 0;
+    int tx_size_min = 1;
+    int tx_size_max = 5;
+    int required_validators = 0; // Validators that must reach publish_threshold (Network's M).
+    uint64_t seed = 0;           // Proposer choice.
+};
+
+class FluidModel
+{
+public:
+    // FluidResult: Totals of a fluid run; counts are expected values, not integers.
+    struct FluidResult
+    {
+        int total_simulated_time = 0;
+        double published = 0.0;
+        double published_kb = 0.0;
+        int forced_publish_count = 0;
+        double pending = 0.0;
+        std::vector<LogHistogram> peer_coverage;      // One per coverage fraction.
+        std::vector<LogHistogram> validator_coverage; // One per coverage fraction.
+        QuantileSketch inclusion;
+        SteadyStateDetector steady_state;
+        bool stopped_on_convergence = false;
+    };
+
+    // connections[p]: p's neighbours as {peer, delay_ms} (Connection).
+    template <typename Conn>
+    FluidModel(const std::vector<std::vector<Conn>> &connections, const std::vector<int> &validator_ids,
+               const std::vector<int> &seed_peers, const FluidConfig &config = {})
+        : num_peers(static_cast<int>(connections.size())), validator_ids(validator_ids), seed_peers(seed_peers), config(config)
+    {
+        links.resize(connections.size());
+        for (size_t u = 0; u < connections.size(); ++u)
+            for (const auto &conn : connections[u])
+                links[u].push_back({conn.peer, conn.delay_ms});
+    }
+
+    FluidResult run(const FluidParams &params, const std::vector<double> &coverage_fractions,
+                    const SteadyStateConfig &steady_config = {})
+    {
+        p = params;
+        setup(coverage_fractions);
+        FluidResult result;
+        result.peer_coverage.resize(coverage_fractions.size());
+        result.validator_coverage.resize(coverage_fractions.size());
+        result.steady_state.configure(steady_config);
+        result.steady_state.reset(0, 0, 0, 0);
+        out = &result;
+
+        int block_cycle_time = 0;
+        while (time_ms < p.total_simulation_ms && !result.stopped_on_convergence)
+        {
+            while (block_cycle_time < p.blocktime + publish_attempt_counter && time_ms < p.total_simulation_ms)
+            {
+                step();
+                block_cycle_time += p.simulation_step_ms;
+            }
+            if (!proposing)
+                propose();
+            if (!proposing)
+            {
+                // Nothing known to the proposer yet: let the network catch up.
+                step();
+                block_cycle_time += p.simulation_step_ms;
+                continue;
+            }
+            if (try_publish())
+            {
+                block_cycle_time = 0;
+                result.steady_state.add_block(time_ms, std::llround(result.published), std::llround(result.published_kb),
+                                              std::llround(pending()));
+                result.stopped_on_convergence = steady_config.stop_on_convergence && result.steady_state.converged();
+            }
+        }
+        result.total_simulated_time = time_ms;
+        result.pending = pending();
+        out = nullptr;
+        return result;
+    }
+
+private:
+    static constexpr double COVERAGE_EPSILON = 0.5; // Summed known fractions are rounded to whole peers.
+    static constexpr double EMPTY_VOLUME = 1e-6;
+    static constexpr double HELD_EPSILON = 1e-9; // Backlog below this counts as none.
+
+    struct OutLink
+    {
+        int peer;
+        int delay_ms;
+    };
+
+    struct InLink
+    {
+        int sender;
+        int lag;       // Steps.
+        int offset_ms; // Where in its last step a delivery lands.
+    };
+
+    struct LinkState
+    {
+        double sent = 0.0;
+        double held = 0.0;
+    };
+
+    struct Bucket
+    {
+        int inject_ms;
+        double volume;
+        double proposed = 0.0;       // Part of volume in the current proposal.
+        double proposer_known = 1.0; // Proposer's known fraction when proposed.
+        // Ring of depth x num_peers known fractions; empty once every peer knows the bucket.
+        std::vector<double> known;
+        // Per in-link (in_offset order): fraction sent so far and backlog held back last step.
+        std::vector<LinkState> links;
+        double peers_known = 0.0;      // Sum of known fractions over peers, last step.
+        double validators_known = 0.0; // The same over validators.
+        size_t peer_level = 0;         // Next coverage level not yet reached.
+        size_t validator_level = 0;
+    };
+
+    int lag_steps(int delay_ms) const
+    {
+        return std::max(1, (delay_ms + p.simulation_step_ms - 1) / p.simulation_step_ms);
+    }
+
+    void setup(const std::vector<double> &coverage_fractions)
+    {
+        depth = 2;
+        incoming.assign(num_peers, {});
+        for (int u = 0; u < num_peers; ++u)
+            for (const auto &link : links[u])
+            {
+                int lag = lag_steps(link.delay_ms);
+                incoming[link.peer].push_back({u, lag, link.delay_ms - (lag - 1) * p.simulation_step_ms});
+                depth = std::max(depth, lag + 1);
+            }
+        in_offset.assign(num_peers + 1, 0);
+        for (int v = 0; v < num_peers; ++v)
+            in_offset[v + 1] = in_offset[v] + incoming[v].size();
+        is_validator.assign(num_peers, false);
+        for (int v : validator_ids)
+            is_validator[v] = true;
+        peer_targets.clear();
+        validator_targets.clear();
+        for (double f : coverage_fractions)
+        {
+            peer_targets.push_back(std::max(1.0, std::ceil(f * num_peers)));
+            validator_targets.push_back(std::max(1.0, std::ceil(f * validator_ids.size())));
+        }
+        groups.clear();
+        int group_count = std::min<int>(std::max(config.origin_groups, 1), static_cast<int>(seed_peers.size()));
+        for (int g = 0; g < group_count; ++g)
+            groups.emplace_back(seed_peers.begin() + seed_peers.size() * g / group_count,
+                                seed_peers.begin() + seed_peers.size() * (g + 1) / group_count);
+        mean_size_kb = (p.tx_size_min + p.tx_size_max) / 2.0;
+        engine.seed(p.seed);
+        buckets.clear();
+        scale.assign(num_peers, 1.0);
+        demand.assign(num_peers, 0.0);
+        budget.assign(num_peers, 0.0);
+        arrival.assign(num_peers, 0);
+        gain.assign(num_peers, 0.0);
+        fresh.assign(in_offset[num_peers], 0.0);
+        time_ms = 0;
+        step_index = 0;
+        publish_attempt_counter = 0;
+        proposing = false;
+    }
+
+    double pending() const
+    {
+        double total = 0.0;
+        for (const auto &b : buckets)
+            total += b.volume;
+        return total;
+    }
+
+    // Ring slot of step s; steps before the first one map onto the injected values.
+    size_t slot(int64_t s) const
+    {
+        return static_cast<size_t>((s % depth + depth) % depth);
+    }
+
+    // Known fraction of bucket b at peer v after step s (1 once the bucket settled).
+    double known(const Bucket &b, int64_t s, int v) const
+    {
+        return b.known.empty() ? 1.0 : b.known[slot(s) * num_peers + v];
+    }
+
+    void inject()
+    {
+        if (p.injection_count <= 0 || seed_peers.empty())
+            return;
+        for (const auto &group : groups)
+        {
+            Bucket b;
+            b.inject_ms = time_ms;
+            b.volume = static_cast<double>(p.injection_count) * group.size() / seed_peers.size();
+            std::vector<double> initial(num_peers, 0.0);
+            for (int peer : group)
+                initial[peer] = 1.0 / group.size();
+            // Known "before" this step at every lag the ring can look back.
+            b.known.reserve(static_cast<size_t>(depth) * num_peers);
+            for (int d = 0; d < depth; ++d)
+                b.known.insert(b.known.end(), initial.begin(), initial.end());
+            b.links.assign(in_offset[num_peers], LinkState{});
+            for (int peer : group)
+            {
+                b.peers_known += initial[peer];
+                if (is_validator[peer])
+                    b.validators_known += initial[peer];
+            }
+            buckets.push_back(std::move(b));
+        }
+    }
+
+    // One simulation step: inject, share bandwidth, propagate, record coverage.
+    void step()
+    {
+        inject();
+        const int64_t s = step_index;
+        // Senders serve buckets oldest first, as the exact engine walks global_pending.
+        std::fill(budget.begin(), budget.end(), p.bandwidth_kb_per_ms * p.simulation_step_ms);
+        for (auto &b : buckets)
+        {
+            if (b.known.empty())
+                continue;
+            const double kb = b.volume * mean_size_kb;
+            std::fill(demand.begin(), demand.end(), 0.0);
+            for (int v = 0; v < num_peers; ++v)
+            {
+                double missing = 1.0 - known(b, s - 1, v);
+                if (missing <= 0.0)
+                    continue;
+                for (size_t i = 0; i < incoming[v].size(); ++i)
+                {
+                    const InLink &in = incoming[v][i];
+                    const LinkState &l = b.links[in_offset[v] + i];
+                    demand[in.sender] += kb * news(known(b, s - in.lag, in.sender) - l.sent, l.sent) * missing;
+                }
+            }
+            for (int u = 0; u < num_peers; ++u)
+                scale[u] = demand[u] <= budget[u] ? 1.0 : budget[u] > 0.0 ? budget[u] / demand[u] : 0.0;
+
+            double *now = &b.known[slot(s) * num_peers];
+            double peers = 0.0, validators = 0.0;
+            bool settled = true;
+            for (int v = 0; v < num_peers; ++v)
+            {
+                double before = known(b, s - 1, v);
+                double unknown = 1.0 - before;
+                double offered_total = 0.0;
+                double *offer = &fresh[in_offset[v]];
+                arrival[v] = p.simulation_step_ms;
+                for (size_t i = 0; i < incoming[v].size(); ++i)
+                {
+                    const InLink &in = incoming[v][i];
+                    LinkState &l = b.links[in_offset[v] + i];
+                    double pending = std::max(0.0, known(b, s - in.lag, in.sender) - l.sent);
+                    double sent = scale[in.sender] * pending;
+                    offer[i] = news(sent, l.sent);
+                    unknown *= 1.0 - offer[i];
+                    offered_total += offer[i];
+                    if (offer[i] > 0.0)
+                        arrival[v] = std::min(arrival[v], l.held > HELD_EPSILON ? 0 : in.offset_ms);
+                    l.sent += sent;
+                    l.held = pending - sent;
+                }
+                now[v] = offered_total > 0.0 ? 1.0 - unknown : before;
+                gain[v] = now[v] - before;
+                // Only deliveries cost bandwidth; split them over the senders that offered.
+                if (gain[v] > 0.0 && offered_total > 0.0)
+                    for (size_t i = 0; i < incoming[v].size(); ++i)
+                        budget[incoming[v][i].sender] -= gain[v] * kb * offer[i] / offered_total;
+                peers += now[v];
+                if (is_validator[v])
+                    validators += now[v];
+                settled = settled && unknown <= 1e-9;
+            }
+            record_coverage(b, b.peers_known, peers, peer_targets, b.peer_level, out->peer_coverage, false);
+            record_coverage(b, b.validators_known, validators, validator_targets, b.validator_level,
+                            out->validator_coverage, true);
+            b.peers_known = peers;
+            b.validators_known = validators;
+            if (settled)
+            {
+                b.known.clear();
+                b.links.clear();
+            }
+        }
+        ++step_index;
+        time_ms += p.simulation_step_ms;
+    }
+
+    // Part of a send that is new to the receiver: sent over what the link had not sent before.
+    static double news(double sent, double sent_before)
+    {
+        if (sent <= 0.0)
+            return 0.0;
+        return sent_before < 1.0 - 1e-12 ? std::min(1.0, sent / (1.0 - sent_before)) : 1.0;
+    }
+
+    // Record every coverage level the bucket's summed known fraction crossed this step. Each
+    // peer's gain lands at its earliest arrival into the step, as in the exact engine.
+    void record_coverage(const Bucket &b, double before, double after, const std::vector<double> &targets, size_t &level,
+                         std::vector<LogHistogram> &latency, bool validators_only)
+    {
+        if (level >= targets.size() || after < targets[level] - COVERAGE_EPSILON)
+            return;
+        arrivals.clear();
+        for (int v = 0; v < num_peers; ++v)
+            if (gain[v] > 0.0 && (!validators_only || is_validator[v]))
+                arrivals.emplace_back(arrival[v], gain[v]);
+        std::sort(arrivals.begin(), arrivals.end());
+        uint64_t txs = static_cast<uint64_t>(std::llround(b.volume));
+        double covered = before;
+        size_t next = 0;
+        int at_ms = 0;
+        for (; level < targets.size() && after >= targets[level] - COVERAGE_EPSILON; ++level)
+        {
+            while (covered < targets[level] - COVERAGE_EPSILON && next < arrivals.size())
+            {
+                covered += arrivals[next].second;
+                at_ms = arrivals[next++].first;
+            }
+            if (txs > 0)
+                latency[level].record(static_cast<uint64_t>(time_ms + at_ms - b.inject_ms), txs);
+        }
+    }
+
+    void propose()
+    {
+        if (validator_ids.empty())
+            return;
+        std::uniform_int_distribution<size_t> dis(0, validator_ids.size() - 1);
+        int proposer = validator_ids[dis(engine)];
+        const int64_t s = step_index - 1;
+        double candidates = 0.0;
+        for (const auto &b : buckets)
+            candidates += b.volume * known(b, s, proposer);
+        if (candidates < 0.5)
+            return;
+        double share = std::min({1.0, p.max_transactions / candidates, p.max_block_size / (candidates * mean_size_kb)});
+        for (auto &b : buckets)
+        {
+            b.proposer_known = known(b, s, proposer);
+            b.proposed = share * b.volume * b.proposer_known;
+        }
+        proposing = true;
+    }
+
+    // Fraction of bucket b's proposed volume that validator w knows (nested known sets).
+    double proposal_known(const Bucket &b, int64_t s, int w) const
+    {
+        return b.proposer_known > 0.0 ? std::min(1.0, known(b, s, w) / b.proposer_known) : 0.0;
+    }
+
+    bool try_publish()
+    {
+        const int64_t s = step_index - 1;
+        double proposed = 0.0;
+        for (const auto &b : buckets)
+            proposed += b.proposed;
+        int meeting = 0;
+        for (int w : validator_ids)
+        {
+            double covered = 0.0;
+            for (const auto &b : buckets)
+                if (b.proposed > 0.0)
+                    covered += b.proposed * proposal_known(b, s, w);
+            if (covered * 100.0 / proposed >= p.publish_threshold)
+                ++meeting;
+        }
+        if (meeting < p.required_validators)
+        {
+            publish_attempt_counter += p.simulation_step_ms;
+            if (publish_attempt_counter < p.blocktime)
+                return false;
+            ++out->forced_publish_count;
+            time_ms += 2 * p.blocktime;
+        }
+        publish();
+        return true;
+    }
+
+    // Remove the proposal from its buckets. Peers lose what they knew of it.
+    void publish()
+    {
+        for (auto &b : buckets)
+        {
+            if (b.proposed <= 0.0)
+                continue;
+            out->inclusion.add(time_ms - b.inject_ms, static_cast<uint64_t>(std::llround(b.proposed)));
+            out->published += b.proposed;
+            out->published_kb += b.proposed * mean_size_kb;
+            double remaining = b.volume - b.proposed;
+            if (remaining > EMPTY_VOLUME && !b.known.empty())
+            {
+                auto keep = [&](double x)
+                {
+                    double removed = b.proposer_known > 0.0 ? std::min(1.0, x / b.proposer_known) : 0.0;
+                    return std::clamp((x * b.volume - b.proposed * removed) / remaining, 0.0, 1.0);
+                };
+                for (double &x : b.known)
+                    x = keep(x);
+                for (LinkState &l : b.links)
+                {
+                    double before = l.sent + l.held;
+                    l.sent = keep(l.sent);
+                    l.held = std::max(0.0, keep(before) - l.sent);
+                }
+            }
+            b.volume = remaining;
+            b.proposed = 0.0;
+        }
+        std::erase_if(buckets, [](const Bucket &b)
+                      { return b.volume <= EMPTY_VOLUME; });
+        publish_attempt_counter = 0;
+        proposing = false;
+    }
+
+    int num_peers;
+    std::vector<std::vector<OutLink>> links;
+    std::vector<int> validator_ids;
+    std::vector<int> seed_peers;
+    FluidConfig config;
+
+    // Per run.
+    FluidParams p;
+    FluidResult *out = nullptr;
+    std::vector<std::vector<InLink>> incoming;
+    std::vector<size_t> in_offset; // Per peer: index of its first in-link in Bucket::links.
+    std::vector<bool> is_validator;
+    std::vector<double> peer_targets, validator_targets;
+    std::vector<std::vector<int>> groups;
+    std::vector<Bucket> buckets;
+    std::vector<double> scale, demand, budget; // Per sender, this step.
+    std::vector<int> arrival;   // Per peer, last step: earliest arrival (ms into the step).
+    std::vector<double> gain;   // Per peer, last step: known fraction gained.
+    std::vector<double> fresh;  // Per in-link, this step: news() of what it sent.
+    std::vector<std::pair<int, double>> arrivals;
+    std::mt19937_64 engine;
+    double mean_size_kb = 0.0;
+    int depth = 2;
+    int64_t step_index = 0; // Steps completed.
+    int time_ms = 0;        // Simulated time, forced-publish stalls included.
+    int publish_attempt_counter = 0;
+    bool proposing = false;
+};
+
+#endif // FLUID_HPP
@@ -0,0 +1,106 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <vector>
+#include <bit>
+#include <cstdint>
+#include <algorithm>
+
+/*
+=======================================================================
+  LOG-BUCKETED HISTOGRAM
+=======================================================================
+
+HDR-style histogram of non-negative integer values (e.g. latencies in
+ms). Values below 2^SUB_BITS get exact buckets; above that every power of
+two is split into 2^SUB_BITS linear sub-buckets, so any recorded value
+is reported within 1 / 2^SUB_BITS (~3%) relative error. record() is a
+couple of bit operations and one increment, cheap enough for hot paths.
+*/
+
+class LogHistogram
+{
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+
+    void record(uint64_t value, uint64_t n = 1)
+    {
+        size_t index = bucket_index(value);
+        if (index >= buckets.size())
+            buckets.resize(index + 1, 0);
+        buckets[index] += n;
+        total += n;
+        max_value = std::max(max_value, value);
+        min_value = std::min(min_value, value);
+        sum += static_cast<double>(value) * n;
+    }
+
+    void merge(const LogHistogram &other)
+    {
+        if (other.buckets.size() > buckets.size())
+            buckets.resize(other.buckets.size(), 0);
+        for (size_t i = 0; i < other.buckets.size(); ++i)
+            buckets[i] += other.buckets[i];
+        total += other.total;
+        sum += other.sum;
+        max_value = std::max(max_value, other.max_value);
+        min_value = std::min(min_value, other.min_value);
+    }
+
+    void clear()
+    {
+        buckets.clear();
+        total = 0;
+        sum = 0.0;
+        max_value = 0;
+        min_value = UINT64_MAX;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_value; }
+    uint64_t min() const { return total ? min_value : 0; }
+    double mean() const { return total ? sum / total : 0.0; }
+
+    // Value at quantile q in [0, 1] (upper edge of its bucket, clamped to the max seen).
+    uint64_t quantile(double q) const
+    {
+        if (total == 0)
+            return 0;
+        uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+                return std::min(bucket_upper(i), max_value);
+        }
+        return max_value;
+    }
+
+private:
+    static size_t bucket_index(uint64_t value)
+    {
+        if (value < SUB_COUNT)
+            return static_cast<size_t>(value);
+        int shift = std::bit_width(value) - 1 - SUB_BITS; // >= 0
+        return static_cast<size_t>((shift + 1) * SUB_COUNT + ((value >> shift) - SUB_COUNT));
+    }
+
+    static uint64_t bucket_upper(size_t index)
+    {
+        if (index < SUB_COUNT)
+            return index;
+        int shift = static_cast<int>(index / SUB_COUNT) - 1;
+        uint64_t sub = index % SUB_COUNT + SUB_COUNT;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> buckets;
+    uint64_t total = 0;
+    double sum = 0.0;
+    uint64_t max_value = 0;
+    uint64_t min_value = UINT64_MAX;
+};
+
+#endif // HISTOGRAM_HPP
@@ -0,0 +1,456 @@
+#ifndef KNOWN_SET_HPP
+#define KNOWN_SET_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <cstring>
+#include <atomic>
+#include <montecarlo/popcount.hpp>
+
+/*
+=======================================================================
+  KNOWN SET HEADER
+=======================================================================
+
+Per-peer record of which transaction ids a peer has learned. Ids are
+grouped into blocks of 65536 and each block is held in the cheaper of two
+container kinds (the roaring bitmap layout):
+
+  - array:  sorted 16-bit offsets, used while the block holds at most
+            ARRAY_MAX ids (2 bytes per id);
+  - bitmap: 1024 64-bit words, used once the block gets denser (8 KB).
+
+Empty blocks hold no storage, so memory follows what a peer actually
+knows rather than the configured id space.
+
+The same structure holds the pending and proposed id sets, so block
+selection and coverage checks are container-wise AND / ANDNOT /
+cardinality operations instead of per-id lookups.
+
+Containers are held by shared_ptr and copied on write: copying a
+KnownSet (Network::fork) shares every block, and a copy duplicates a
+block only when it first changes it.
+*/
+
+class KnownSet
+{
+public:
+    static constexpr int BLOCK_BITS = 1 << 16;          // Ids per block.
+    static constexpr int BLOCK_WORDS = BLOCK_BITS / 64; // 64-bit words in a bitmap container.
+    static constexpr int ARRAY_MAX = 4096;              // Largest array container before switching to a bitmap.
+
+    // Container: one block of ids, either a sorted array or a bitmap.
+    struct Container
+    {
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array;          // Sorted offsets (array container).
+        std::unique_ptr<uint64_t[]> bitmap;   // BLOCK_WORDS words (bitmap container).
+
+        Container() = default;
+        Container(Container &&) = default;
+        Container &operator=(Container &&) = default;
+        Container(const Container &other) : cardinality(other.cardinality), array(other.array)
+        {
+            if (other.bitmap)
+            {
+                bitmap = std::make_unique_for_overwrite<uint64_t[]>(BLOCK_WORDS);
+                std::memcpy(bitmap.get(), other.bitmap.get(), BLOCK_WORDS * sizeof(uint64_t));
+            }
+        }
+
+        bool is_bitmap() const { return bitmap != nullptr; }
+
+        bool test(uint16_t low) const
+        {
+            if (bitmap)
+                return (bitmap[low >> 6] >> (low & 63)) & 1ULL;
+            // Fast path: propagating ids are usually above everything learned so far.
+            if (array.empty() || low > array.back())
+                return false;
+            return std::binary_search(array.begin(), array.end(), low);
+        }
+
+        // Returns true if low was not present before.
+        bool set(uint16_t low)
+        {
+            if (bitmap)
+            {
+                uint64_t &w = bitmap[low >> 6];
+                uint64_t mask = 1ULL << (low & 63);
+                if (w & mask)
+                    return false;
+                w |= mask;
+                cardinality++;
+                return true;
+            }
+            // Ids are mostly learned in increasing order, so check the tail first.
+            auto it = (array.empty() || array.back() < low) ? array.end()
+                                                            : std::lower_bound(array.begin(), array.end(), low);
+            if (it != array.end() && *it == low)
+                return false;
+            array.insert(it, low);
+            cardinality++;
+            if (cardinality > ARRAY_MAX)
+                to_bitmap();
+            return true;
+        }
+
+        void to_bitmap()
+        {
+            bitmap = std::make_unique<uint64_t[]>(BLOCK_WORDS); // zero-initialized
+            for (uint16_t low : array)
+                bitmap[low >> 6] |= 1ULL << (low & 63);
+            std::vector<uint16_t>().swap(array);
+        }
+
+        void to_array()
+        {
+            array.clear();
+            array.reserve(cardinality);
+            for (int w = 0; w < BLOCK_WORDS; ++w)
+                for (uint64_t bits = bitmap[w]; bits; bits &= bits - 1)
+                    array.push_back(static_cast<uint16_t>(w * 64 + std::countr_zero(bits)));
+            bitmap.reset();
+        }
+
+        size_t memory_bytes() const
+        {
+            return bitmap ? BLOCK_WORDS * sizeof(uint64_t) : array.capacity() * sizeof(uint16_t);
+        }
+
+        // Calls fn(low) for every offset in increasing order.
+        template <typename F>
+        void for_each(F &&fn) const
+        {
+            if (!bitmap)
+            {
+                for (uint16_t low : array)
+                    fn(low);
+                return;
+            }
+            for (int w = 0; w < BLOCK_WORDS; ++w)
+                for (uint64_t bits = bitmap[w]; bits; bits &= bits - 1)
+                    fn(static_cast<uint16_t>(w * 64 + std::countr_zero(bits)));
+        }
+
+        // Number of offsets present in both containers.
+        static size_t and_cardinality(const Container &a, const Container &b)
+        {
+            if (a.cardinality == 0 || b.cardinality == 0)
+                return 0;
+            if (a.bitmap && b.bitmap)
+                return popcount_and(a.bitmap.get(), b.bitmap.get(), BLOCK_WORDS);
+            if (a.bitmap || b.bitmap)
+            {
+                const Container &arr = a.bitmap ? b : a;
+                const Container &bm = a.bitmap ? a : b;
+                size_t total = 0;
+                for (uint16_t low : arr.array)
+                    total += (bm.bitmap[low >> 6] >> (low & 63)) & 1ULL;
+                return total;
+            }
+            size_t total = 0;
+            for_each_common(a.array, b.array, [&](uint16_t)
+                            { total++; });
+            return total;
+        }
+
+        // Calls fn(low) for every offset present in both containers, in increasing order.
+        template <typename F>
+        static void for_each_and(const Container &a, const Container &b, F &&fn)
+        {
+            if (a.cardinality == 0 || b.cardinality == 0)
+                return;
+            if (a.bitmap && b.bitmap)
+            {
+                for (int w = 0; w < BLOCK_WORDS; ++w)
+                    for (uint64_t bits = a.bitmap[w] & b.bitmap[w]; bits; bits &= bits - 1)
+                        fn(static_cast<uint16_t>(w * 64 + std::countr_zero(bits)));
+                return;
+            }
+            if (a.bitmap || b.bitmap)
+            {
+                const Container &arr = a.bitmap ? b : a;
+                const Container &bm = a.bitmap ? a : b;
+                for (uint16_t low : arr.array)
+                    if ((bm.bitmap[low >> 6] >> (low & 63)) & 1ULL)
+                        fn(low);
+                return;
+            }
+            for_each_common(a.array, b.array, fn);
+        }
+
+        // Removes every offset present in other.
+        void and_not(const Container &other)
+        {
+            if (cardinality == 0 || other.cardinality == 0)
+                return;
+            if (bitmap)
+            {
+                if (other.bitmap)
+                {
+                    for (int w = 0; w < BLOCK_WORDS; ++w)
+                        bitmap[w] &= ~other.bitmap[w];
+                }
+                else
+                {
+                    for (uint16_t low : other.array)
+                        bitmap[low >> 6] &= ~(1ULL << (low & 63));
+                }
+                size_t total = 0;
+                for (int w = 0; w < BLOCK_WORDS; ++w)
+                    total += std::popcount(bitmap[w]);
+                cardinality = static_cast<uint32_t>(total);
+                if (cardinality <= ARRAY_MAX)
+                    to_array();
+                return;
+            }
+            std::erase_if(array, [&](uint16_t low)
+                          { return other.test(low); });
+            cardinality = static_cast<uint32_t>(array.size());
+        }
+
+    private:
+        // Sorted-array intersection; gallops through the larger side when sizes are skewed.
+        template <typename F>
+        static void for_each_common(const std::vector<uint16_t> &a, const std::vector<uint16_t> &b, F &&fn)
+        {
+            const std::vector<uint16_t> &small = a.size() <= b.size() ? a : b;
+            const std::vector<uint16_t> &large = a.size() <= b.size() ? b : a;
+            auto it = large.begin();
+            if (small.size() * 32 < large.size())
+            {
+                for (uint16_t low : small)
+                {
+                    it = std::lower_bound(it, large.end(), low);
+                    if (it == large.end())
+                        return;
+                    if (*it == low)
+                        fn(low);
+                }
+                return;
+            }
+            auto jt = small.begin();
+            while (it != large.end() && jt != small.end())
+            {
+                if (*it < *jt)
+                    ++it;
+                else if (*jt < *it)
+                    ++jt;
+                else
+                {
+                    fn(*jt);
+                    ++it;
+                    ++jt;
+                }
+            }
+        }
+    };
+
+    bool test(int id) const
+    {
+        size_t block = static_cast<size_t>(id) / BLOCK_BITS;
+        if (block >= blocks.size() || !blocks[block])
+            return false;
+        return blocks[block]->test(static_cast<uint16_t>(id % BLOCK_BITS));
+    }
+
+    void set(int id)
+    {
+        size_t block = static_cast<size_t>(id) / BLOCK_BITS;
+        uint16_t low = static_cast<uint16_t>(id % BLOCK_BITS);
+        if (block >= blocks.size())
+            blocks.resize(block + 1);
+        // A block shared with a fork is only copied if the id is really new.
+        if (blocks[block] && blocks[block].use_count() > 1 && blocks[block]->test(low))
+            return;
+        if (own_block(block).set(low))
+            count++;
+    }
+
+    // Number of ids in the set.
+    size_t cardinality() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    // Calls fn(id) for every id in increasing order.
+    template <typename F>
+    void for_each(F &&fn) const
+    {
+        for (size_t b = 0; b < blocks.size(); ++b)
+        {
+            int base = static_cast<int>(b * BLOCK_BITS);
+            block(b).for_each([&](uint16_t low)
+                              { fn(base + low); });
+        }
+    }
+
+    // |a AND b|
+    static size_t and_cardinality(const KnownSet &a, const KnownSet &b)
+    {
+        size_t n = std::min(a.blocks.size(), b.blocks.size());
+        size_t total = 0;
+        for (size_t i = 0; i < n; ++i)
+            total += Container::and_cardinality(a.block(i), b.block(i));
+        return total;
+    }
+
+    // out[j] = |a AND others[j]| for j < count. Bitmap blocks of a are streamed once
+    // against every other bitmap block through the SIMD kernel.
+    static void and_cardinality_many(const KnownSet &a, const KnownSet *const *others, size_t count, uint64_t *out)
+    {
+        std::vector<const uint64_t *> bitmaps;
+        std::vector<uint64_t *> targets;
+        std::vector<uint64_t> partial;
+        for (size_t j = 0; j < count; ++j)
+            out[j] = 0;
+        for (size_t i = 0; i < a.blocks.size(); ++i)
+        {
+            const Container &ca = a.block(i);
+            if (ca.cardinality == 0)
+                continue;
+            bitmaps.clear();
+            targets.clear();
+            for (size_t j = 0; j < count; ++j)
+            {
+                if (i >= others[j]->blocks.size())
+                    continue;
+                const Container &cb = others[j]->block(i);
+                if (ca.bitmap && cb.bitmap)
+                {
+                    bitmaps.push_back(cb.bitmap.get());
+                    targets.push_back(&out[j]);
+                }
+                else
+                {
+                    out[j] += Container::and_cardinality(ca, cb);
+                }
+            }
+            if (bitmaps.empty())
+                continue;
+            partial.assign(bitmaps.size(), 0);
+            popcount_and_many(ca.bitmap.get(), bitmaps.data(), bitmaps.size(), BLOCK_WORDS, partial.data());
+            for (size_t k = 0; k < targets.size(); ++k)
+                *targets[k] += partial[k];
+        }
+    }
+
+    // Calls fn(id) for every id in (a AND b), in increasing order.
+    template <typename F>
+    static void for_each_and(const KnownSet &a, const KnownSet &b, F &&fn)
+    {
+        size_t n = std::min(a.blocks.size(), b.blocks.size());
+        for (size_t i = 0; i < n; ++i)
+        {
+            int base = static_cast<int>(i * BLOCK_BITS);
+            Container::for_each_and(a.block(i), b.block(i), [&](uint16_t low)
+                                    { fn(base + low); });
+        }
+    }
+
+    // this = this ANDNOT other
+    void and_not(const KnownSet &other)
+    {
+        size_t n = std::min(blocks.size(), other.blocks.size());
+        count = 0;
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            if (!blocks[i])
+                continue;
+            // A block shared with a fork is only copied if other removes something from it.
+            if (i < n && other.block(i).cardinality > 0 &&
+                (blocks[i].use_count() == 1 || Container::and_cardinality(*blocks[i], other.block(i)) > 0))
+            {
+                own_block(i).and_not(other.block(i));
+                if (blocks[i]->cardinality == 0)
+                    blocks[i].reset();
+            }
+            if (blocks[i])
+                count += blocks[i]->cardinality;
+        }
+    }
+
+    // Release all containers.
+    void clear()
+    {
+        blocks.clear();
+        blocks.shrink_to_fit();
+        count = 0;
+    }
+
+    // Snapshot support: fn(block, container) for every non-empty block, in block order.
+    template <typename F>
+    void for_each_container(F &&fn) const
+    {
+        for (size_t b = 0; b < blocks.size(); ++b)
+            if (blocks[b] && blocks[b]->cardinality)
+                fn(b, *blocks[b]);
+    }
+
+    // Snapshot support: replace a block with cardinality sorted offsets (array), or with
+    // BLOCK_WORDS words (bitmap) when bitmap is non-null. The container kind is kept as given.
+    void load_container(size_t block, uint32_t cardinality, const uint16_t *array, const uint64_t *bitmap)
+    {
+        if (block >= blocks.size())
+            blocks.resize(block + 1);
+        Container &c = own_block(block);
+        count -= c.cardinality;
+        c = Container{};
+        c.cardinality = cardinality;
+        if (bitmap)
+        {
+            c.bitmap = std::make_unique<uint64_t[]>(BLOCK_WORDS);
+            std::memcpy(c.bitmap.get(), bitmap, BLOCK_WORDS * sizeof(uint64_t));
+        }
+        else
+            c.array.assign(array, array + cardinality);
+        count += cardinality;
+    }
+
+    // Bytes currently held by the block table and its containers. With exclusive_only,
+    // containers shared with a fork are left out.
+    size_t memory_bytes(bool exclusive_only = false) const
+    {
+        size_t bytes = blocks.capacity() * sizeof(blocks[0]);
+        for (const auto &c : blocks)
+            if (c && (!exclusive_only || c.use_count() == 1))
+                bytes += sizeof(Container) + c->memory_bytes();
+        return bytes;
+    }
+
+private:
+    // Block b for reading (an empty container if absent).
+    const Container &block(size_t b) const
+    {
+        static const Container empty;
+        return b < blocks.size() && blocks[b] ? *blocks[b] : empty;
+    }
+
+    // Block b for writing: created if absent, copied first if shared with another set.
+    Container &own_block(size_t b)
+    {
+        std::shared_ptr<Container> &c = blocks[b];
+        if (!c)
+            c = std::make_shared<Container>();
+        else if (c.use_count() > 1)
+            c = std::make_shared<Container>(*c);
+        else
+            std::atomic_thread_fence(std::memory_order_acquire); // Pairs with other owners' release on drop.
+        return *c;
+    }
+
+    std::vector<std::shared_ptr<Container>> blocks; // Null for empty blocks.
+    size_t count = 0;
+};
+
+#endif // KNOWN_SET_HPP
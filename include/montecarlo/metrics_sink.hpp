@@ -0,0 +1,228 @@
+#ifndef METRICS_SINK_HPP
+#define METRICS_SINK_HPP
+
+#include <print>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+/*
+=======================================================================
+  STEP METRICS SINK
+=======================================================================
+
+Per-step time series (pending, in-flight attempts, bytes transmitted,
+throttled attempts, coverage, ...) recorded into a preallocated
+columnar chunk. When a chunk fills it is handed to a background thread
+that writes it out while the simulation keeps filling a second chunk, so
+the main loop only pays for a few stores per step.
+
+Output formats:
+  - CSV:    header line, then one line per step;
+  - Binary: "MCSTEPS\0", uint32 version, uint32 column count, then per
+            column a 32-byte name and a uint32 type (0 = int64,
+            1 = double); followed by chunks of uint32 row count and each
+            column's values back to back (little-endian).
+*/
+
+// StepMetrics: One row of the time series.
+struct StepMetrics
+{
+    int64_t time_ms = 0;              // Simulated time at the end of the step.
+    int64_t pending = 0;              // Injected but not yet published.
+    int64_t in_flight_attempts = 0;   // Delivery attempts still queued after broadcast.
+    int64_t deliveries = 0;           // Attempts delivered during the step.
+    int64_t throttled_attempts = 0;   // Attempts held back by the bandwidth limit.
+    double transmitted_kb = 0.0;      // KB delivered during the step.
+    int64_t published_total = 0;      // Published so far.
+    double coverage_pct = 0.0;        // Mean validator coverage of the current proposal (0 if none).
+};
+
+class MetricsSink
+{
+public:
+    enum class Format
+    {
+        CSV,
+        Binary
+    };
+
+    MetricsSink() = default;
+    MetricsSink(const MetricsSink &) = delete;
+    MetricsSink &operator=(const MetricsSink &) = delete;
+    ~MetricsSink() { close(); }
+
+    bool open(const std::string &path, Format fmt, size_t rows_per_chunk = 4096)
+    {
+        close();
+        file = std::fopen(path.c_str(), fmt == Format::CSV ? "w" : "wb");
+        if (!file)
+        {
+            std::print("Error opening metrics file {}.\n", path);
+            return false;
+        }
+        format = fmt;
+        chunk_rows = rows_per_chunk;
+        filling.reserve(chunk_rows);
+        flushing.reserve(chunk_rows);
+        write_header();
+        stop = false;
+        writer = std::thread([this]
+                             { writer_loop(); });
+        return true;
+    }
+
+    bool is_open() const { return file != nullptr; }
+
+    void record(const StepMetrics &m)
+    {
+        filling.push(m);
+        if (filling.rows == chunk_rows)
+            hand_off();
+    }
+
+    // Flush remaining rows, stop the writer thread and close the file.
+    void close()
+    {
+        if (!file)
+            return;
+        if (filling.rows > 0)
+            hand_off();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cv.notify_all();
+        writer.join();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+private:
+    // Columns: One chunk, struct-of-arrays.
+    struct Columns
+    {
+        std::vector<int64_t> time_ms, pending, in_flight_attempts, deliveries, throttled_attempts, published_total;
+        std::vector<double> transmitted_kb, coverage_pct;
+        size_t rows = 0;
+
+        void reserve(size_t n)
+        {
+            for (auto *c : {&time_ms, &pending, &in_flight_attempts, &deliveries, &throttled_attempts, &published_total})
+                c->resize(n);
+            transmitted_kb.resize(n);
+            coverage_pct.resize(n);
+        }
+
+        void push(const StepMetrics &m)
+        {
+            time_ms[rows] = m.time_ms;
+            pending[rows] = m.pending;
+            in_flight_attempts[rows] = m.in_flight_attempts;
+            deliveries[rows] = m.deliveries;
+            throttled_attempts[rows] = m.throttled_attempts;
+            transmitted_kb[rows] = m.transmitted_kb;
+            published_total[rows] = m.published_total;
+            coverage_pct[rows] = m.coverage_pct;
+            rows++;
+        }
+    };
+
+    static constexpr const char *COLUMN_NAMES[] = {"time_ms", "pending", "in_flight_attempts", "deliveries",
+                                                   "throttled_attempts", "transmitted_kb", "published_total", "coverage_pct"};
+    static constexpr uint32_t COLUMN_TYPES[] = {0, 0, 0, 0, 0, 1, 0, 1};
+
+    // Swap the full chunk with the (already written) spare and wake the writer.
+    void hand_off()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]
+                { return !flush_pending; });
+        std::swap(filling, flushing);
+        filling.rows = 0;
+        flush_pending = true;
+        lock.unlock();
+        cv.notify_all();
+    }
+
+    void writer_loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            cv.wait(lock, [this]
+                    { return flush_pending || stop; });
+            if (flush_pending)
+            {
+                lock.unlock();
+                write_chunk(flushing);
+                lock.lock();
+                flush_pending = false;
+                cv.notify_all();
+            }
+            else if (stop)
+                return;
+        }
+    }
+
+    void write_header()
+    {
+        if (format == Format::CSV)
+        {
+            for (size_t i = 0; i < std::size(COLUMN_NAMES); ++i)
+                std::fprintf(file, i ? ",%s" : "%s", COLUMN_NAMES[i]);
+            std::fputc('\n', file);
+            return;
+        }
+        const uint32_t version = 1, columns = std::size(COLUMN_NAMES);
+        std::fwrite("MCSTEPS\0", 1, 8, file);
+        std::fwrite(&version, sizeof(version), 1, file);
+        std::fwrite(&columns, sizeof(columns), 1, file);
+        for (size_t i = 0; i < columns; ++i)
+        {
+            char name[32] = {};
+            std::strncpy(name, COLUMN_NAMES[i], sizeof(name) - 1);
+            std::fwrite(name, 1, sizeof(name), file);
+            std::fwrite(&COLUMN_TYPES[i], sizeof(uint32_t), 1, file);
+        }
+    }
+
+    void write_chunk(const Columns &c)
+    {
+        if (format == Format::CSV)
+        {
+            for (size_t r = 0; r < c.rows; ++r)
+                std::fprintf(file, "%lld,%lld,%lld,%lld,%lld,%.3f,%lld,%.4f\n",
+                             static_cast<long long>(c.time_ms[r]), static_cast<long long>(c.pending[r]),
+                             static_cast<long long>(c.in_flight_attempts[r]), static_cast<long long>(c.deliveries[r]),
+                             static_cast<long long>(c.throttled_attempts[r]), c.transmitted_kb[r],
+                             static_cast<long long>(c.published_total[r]), c.coverage_pct[r]);
+            return;
+        }
+        const uint32_t rows = static_cast<uint32_t>(c.rows);
+        std::fwrite(&rows, sizeof(rows), 1, file);
+        for (const auto *col : {&c.time_ms, &c.pending, &c.in_flight_attempts, &c.deliveries, &c.throttled_attempts})
+            std::fwrite(col->data(), sizeof(int64_t), rows, file);
+        std::fwrite(c.transmitted_kb.data(), sizeof(double), rows, file);
+        std::fwrite(c.published_total.data(), sizeof(int64_t), rows, file);
+        std::fwrite(c.coverage_pct.data(), sizeof(double), rows, file);
+    }
+
+    std::FILE *file = nullptr;
+    Format format = Format::CSV;
+    size_t chunk_rows = 0;
+    Columns filling;  // Written by the simulation thread.
+    Columns flushing; // Owned by the writer thread while flush_pending.
+    bool flush_pending = false;
+    bool stop = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread writer;
+};
+
+#endif // METRICS_SINK_HPP
@@ -3,15 +3,35 @@
 
 #include <print>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 #include <random>
 #include <set>
+#include <queue>
+#include <tuple>
 #include <algorithm>
 #include <climits>
 #include <string>
+#include <format>
 #include <cmath>
 #include <cstdlib> // for std::abort
+#include <array>
+#include <memory>
+#include <sstream>
+#include <montecarlo/known_set.hpp>
+#include <montecarlo/cow_vector.hpp>
+#include <montecarlo/philox.hpp>
+#include <montecarlo/workload.hpp>
+#include <montecarlo/histogram.hpp>
+#include <montecarlo/quantile_sketch.hpp>
+#include <montecarlo/metrics_sink.hpp>
+#include <montecarlo/profiler.hpp>
+#include <montecarlo/event_trace.hpp>
+#include <montecarlo/digest.hpp>
+#include <montecarlo/snapshot.hpp>
+#include <montecarlo/steady_state.hpp>
+#include <montecarlo/fluid.hpp>
+#include <montecarlo/worker_pool.hpp>
+#include <montecarlo/sharded.hpp>
 
 /*
 =======================================================================
@@ -23,6 +43,9 @@ peer-to-peer network. The simulation models the propagation of unique
 transactions among network nodes (peers) connected by links with a fixed
 delay (ms). Key aspects include transaction propagation, delivery attempts,
 and publishing transactions based on validator consensus.
+
+Peers are identified by dense 0-based indices, so all per-peer state is
+held in vectors indexed by peer rather than hash maps.
 */
 
 //////////////////////////
@@ -37,23 +60,25 @@ struct Transaction
     Transaction(int id, int size_kb) : id(id), size_kb(size_kb) {}
 };
 
-// Connection: Represents a link between two peers with a fixed delay.
+// Connection: Represents a link to a neighboring peer with a fixed delay.
 struct Connection
 {
+    int peer;     // Index of the neighboring peer.
     int delay_ms; // Delay in milliseconds.
-    Connection() : delay_ms(0) {}
-    Connection(int d) : delay_ms(d) {}
+    Connection() : peer(-1), delay_ms(0) {}
+    Connection(int p, int d) : peer(p), delay_ms(d) {}
 };
 
 // DeliveryAttempt: Represents one attempt to deliver a transaction from one node (sender)
 // to another (receiver). It maintains an independent timer (in ms) that is incremented
-// during broadcast until the connection delay is reached.
+// during broadcast until the connection delay (copied from the link) is reached.
 struct DeliveryAttempt
 {
     int sender;   // The node initiating this delivery attempt.
     int receiver; // The target node for this attempt.
     int timer;    // Elapsed time (ms) for this attempt.
-    DeliveryAttempt(int s, int r) : sender(s), receiver(r), timer(0) {}
+    int delay_ms; // Delay of the sender -> receiver link.
+    DeliveryAttempt(int s, int r, int d) : sender(s), receiver(r), timer(0), delay_ms(d) {}
 
     bool operator==(const DeliveryAttempt &other) const
     {
@@ -70,6 +95,28 @@ struct GlobalPendingTx
     GlobalPendingTx(const Transaction &t, int origin) : tx(t) {}
 };
 
+// BroadcastMode: How broadcast tracks delivery attempts.
+//   Reference: every attempt is kept until it delivers or its receiver learns the tx.
+//   Lazy:      an attempt is dropped when it is queued if an attempt queued before it for the
+//              same receiver delivers no later, so it could never win. Exact while no attempt
+//              is throttled; under throttling a pruned attempt may have been the one to win.
+//   Analytic:  no attempts while bandwidth does not bind: each tx follows its seed's
+//              shortest-path schedule (hop delays rounded up to whole steps, as broadcast
+//              delivers them) and peers learn it by lookup. Exact while no sender could reach
+//              its bandwidth limit and every step has the same length; otherwise in-flight txs
+//              switch to materialized attempts for the rest of the run.
+//   Cohort:    txs injected in the same step at the same seed share one attempt list, so
+//              broadcast tracks one entity per (step, seed) instead of one per tx. Exact while
+//              no sender could reach its bandwidth limit; otherwise cohorts are split into
+//              single txs, which then run as Reference for the rest of the run.
+enum class BroadcastMode
+{
+    Reference,
+    Lazy,
+    Analytic,
+    Cohort
+};
+
 //////////////////////////
 // Network Class
 //////////////////////////
@@ -77,6 +124,32 @@ struct GlobalPendingTx
 class Network
 {
 public:
+    // Coverage levels tracked per transaction: time until it reached this fraction of
+    // all peers / of all validators.
+    static constexpr std::array<double, 3> COVERAGE_FRACTIONS{0.5, 0.9, 1.0};
+
+    // LatencySummary: Quantiles (ms) of a latency histogram; count is how many tx reached it.
+    struct LatencySummary
+    {
+        uint64_t count = 0;
+        uint64_t p50 = 0;
+        uint64_t p90 = 0;
+        uint64_t p99 = 0;
+        uint64_t max = 0;
+
+        static LatencySummary from(const LogHistogram &h)
+        {
+            return LatencySummary{h.count(), h.quantile(0.50), h.quantile(0.90), h.quantile(0.99), h.max()};
+        }
+
+        static LatencySummary from(const QuantileSketch &q)
+        {
+            auto ms = [](double v)
+            { return static_cast<uint64_t>(std::llround(v)); };
+            return LatencySummary{q.count(), ms(q.quantile(0.50)), ms(q.quantile(0.90)), ms(q.quantile(0.99)), ms(q.max())};
+        }
+    };
+
     // ExperimentResult: Holds results from an experiment.
     struct ExperimentResult
     {
@@ -87,47 +160,171 @@ public:
         double MB_per_sec;
         int forced_publish_count;
         int final_pending_count;
+        // Propagation latency to each of COVERAGE_FRACTIONS of peers / validators.
+        std::array<LatencySummary, COVERAGE_FRACTIONS.size()> peer_coverage_ms;
+        std::array<LatencySummary, COVERAGE_FRACTIONS.size()> validator_coverage_ms;
+        // Inclusion latency: injection to publication of the block containing the tx.
+        LatencySummary inclusion_ms;
+        // Wall time, calls and items per hot-path phase (zero unless built with MONTECARLO_PROFILE).
+        std::array<PhaseStats, PHASE_COUNT> phases{};
+        // Golden digest of the run (see set_digest_mode); 0 when digest mode is off.
+        uint64_t digest = 0;
+        // Steady state (see steady_state.hpp): whether it was reached, the warm-up that was
+        // trimmed, and throughput from the end of the warm-up (0 if never steady).
+        bool steady_state = false;
+        int warmup_ms = 0;
+        int steady_blocks = 0;
+        double steady_tps = 0.0;
+        double steady_MB_per_sec = 0.0;
+        bool stopped_on_convergence = false;
+        // Broadcast steps that ran on the worker pool (see set_threads).
+        int parallel_steps = 0;
     };
 
     // Default constructor: seed the random engine with a random seed.
     Network()
     {
         std::random_device rd;
-        engine.seed(rd());
+        unsigned int seed = rd();
+        engine.seed(seed);
+        rng_seed = seed;
+    }
+
+    Network(Network &&) = default;
+    Network &operator=(Network &&) = default;
+
+    // fork: Independent copy of the current state for what-if branches. Topology, known
+    // sets, the pending set and the per-tx arrays are shared copy-on-write, so the fork is
+    // cheap and each side only pays for the blocks and chunks it changes afterwards. The
+    // metrics sink, event tracer and worker threads are not inherited. Parent and fork may run on
+    // different threads.
+    Network fork() const
+    {
+        Network child(*this);
+        child.metrics = nullptr;
+        child.events = nullptr;
+        child.parallel = nullptr;
+        return child;
     }
 
     // set_fixed_seed: Use a fixed seed for reproducible experiments.
     void set_fixed_seed(unsigned int seed)
     {
         engine.seed(seed);
+        rng_seed = seed;
+    }
+
+    // rng_stream: Counter-based stream keyed by (seed, purpose, a, b). Draws depend only on
+    // these keys, so streams can be consumed from any thread or in any order.
+    CounterRng rng_stream(RngPurpose purpose, uint32_t a, uint32_t b = 0) const
+    {
+        return CounterRng(rng_seed, purpose, a, b);
     }
 
 private:
-    std::unordered_map<int, std::unordered_map<int, Connection>> connections;
-    std::unordered_map<int, int> connection_count;
-    std::unordered_map<int, bool> isValidator;
+    // Copies go through fork().
+    Network(const Network &) = default;
+
+    // Topology: links and roles, indexed by peer (0 .. num_peers - 1). Shared between a
+    // network and its forks; mutated only through own_topology().
+    struct Topology
+    {
+        std::vector<std::vector<Connection>> connections;
+        std::vector<int> connection_count;
+        std::vector<bool> isValidator;
+        std::vector<int> validator_ids;
+        // Non-validator peers, where transactions are injected. Rebuilt by select_validators.
+        std::vector<int> seed_peers;
+    };
+    int num_peers = 0;
+    std::shared_ptr<Topology> topology = std::make_shared<Topology>();
     std::vector<GlobalPendingTx> global_pending;
 
-    // Each peer's known matrix: 2D vector<bool> with dimensions known_rows x known_cols.
-    std::unordered_map<int, std::vector<std::vector<bool>>> known;
+    // SeedSchedule: Order in which peers learn a tx injected at one seed when nothing is
+    // throttled, with each hop delay rounded up to whole steps of analytic_step_ms. Entries
+    // are sorted by (step, arrival_ms).
+    struct SeedSchedule
+    {
+        std::vector<int> peer;       // Peers other than the seed that the tx reaches.
+        std::vector<int> step;       // Broadcast step after injection (1-based) in which peer[i] learns.
+        std::vector<int> arrival_ms; // Earliest arrival in that step, ms after injection.
+        std::vector<int> sender;     // Sender of that earliest arrival, and its link delay.
+        std::vector<int> delay_ms;
+        // Every neighbor with an attempt due in that step (CSR), charged for bandwidth checks.
+        std::vector<uint32_t> candidate_offsets;
+        std::vector<int> candidates;
+    };
+
+    // AnalyticTx: A tx propagating by its seed's schedule (BroadcastMode::Analytic).
+    struct AnalyticTx
+    {
+        Transaction tx;
+        int seed;
+        int steps;       // Broadcast steps since injection.
+        uint32_t cursor; // Schedule entries already known.
+    };
+    std::vector<AnalyticTx> analytic_pending;
+    // Step length the schedules are built for; schedules are per seed, built on first use
+    // and shared with forks (dropped when the topology or the step length changes).
+    int analytic_step_ms = 0;
+    std::vector<std::shared_ptr<const SeedSchedule>> seed_schedules;
+
+    // Cohort: Txs injected in the same step at the same seed (BroadcastMode::Cohort). Until
+    // something is throttled they reach every peer at the same time, so they share attempts.
+    struct Cohort
+    {
+        std::vector<int> tx_ids; // Ascending.
+        int64_t size_kb = 0;     // Total size, charged per attempt for bandwidth checks.
+        std::vector<DeliveryAttempt> attempts;
+    };
+    std::vector<Cohort> cohorts;
+
+    // Set once analytic or cohort propagation stopped applying; new txs get their own
+    // attempts until the next run.
+    bool attempts_fallback = false;
 
-    // Pending transactions: an unordered_set of transaction IDs and a lookup map.
-    std::unordered_set<int> pending_tx_ids;
-    std::unordered_map<int, Transaction> tx_lookup;
+    // Each peer's known set: lazily paged bitmap holding up to known_rows x known_cols ids.
+    std::vector<KnownSet> known;
+
+    // Pending transactions: a set of transaction IDs, and every injected transaction's
+    // size indexed by id (ids are dense and only reset by clean_network_txs).
+    KnownSet pending_tx_ids;
+    CowVector<int> tx_size_kb;
 
     int next_tx_id = 0; // Transaction IDs start at 0.
     std::vector<Transaction> proposed_transactions;
     // proposed_ids is declared below proposed_transactions.
-    std::set<int> proposed_ids;
+    KnownSet proposed_ids;
     int publish_attempt_counter = 0;
 
     int total_injected = 0;
     int total_published_global = 0;
 
-    // Validator information.
-    std::vector<int> validator_ids;
+    // Validators required to publish.
     int M = 0;
 
+    InjectionBatch injection_batch;
+
+    // Propagation tracking, indexed by tx id: injection time and how many peers /
+    // validators know the tx. network_time_ms is the time advanced by broadcast.
+    int network_time_ms = 0;
+    CowVector<int> tx_inject_ms;
+    CowVector<uint32_t> tx_known_peers;
+    CowVector<uint16_t> tx_known_validators;
+    // Known-count at which each coverage level is reached, and the latency histograms.
+    std::array<uint32_t, COVERAGE_FRACTIONS.size()> peer_coverage_target{};
+    std::array<uint32_t, COVERAGE_FRACTIONS.size()> validator_coverage_target{};
+    using CoverageHistograms = std::array<LogHistogram, COVERAGE_FRACTIONS.size()>;
+    CoverageHistograms peer_coverage_latency;
+    CoverageHistograms validator_coverage_latency;
+
+    // Inclusion latency (inject -> publish). Forced publishing stalls the chain for
+    // 2 x blocktime without broadcasting, so that stall is tracked apart from network_time_ms:
+    // forced_delay_marks holds (network_time_ms, forced_delay_ms after that stall).
+    int forced_delay_ms = 0;
+    std::vector<std::pair<int, int>> forced_delay_marks;
+    QuantileSketch inclusion_latency;
+
     // Known matrix configuration.
     int known_rows = 1000000; // Default rows.
     int known_cols = 20;      // Default columns.
@@ -142,24 +339,227 @@ private:
 
     // Member random engine for reproducible experiments.
     std::mt19937 engine;
+    // Seed for counter-based streams (see rng_stream).
+    uint64_t rng_seed = 0;
 
-    // Helper: Compute (row, col) from transaction id.
-    void get_known_position(int tx_id, int &row, int &col) const
+    // Progress output; set_verbose(false) silences everything except errors.
+    bool verbose = true;
+
+    template <typename... Args>
+    void log_info(std::format_string<Args...> fmt, Args &&...args) const
     {
-        row = tx_id / known_cols;
-        col = tx_id % known_cols;
+        if (verbose)
+            std::print(fmt, std::forward<Args>(args)...);
     }
 
-    // Helper: Assert that (peer, row, col) is within bounds.
-    void assert_known_bounds(int peer, int row, int col) const
+    // Counters from the last broadcast call.
+    struct BroadcastStats
+    {
+        int64_t deliveries = 0;
+        int64_t throttled_attempts = 0;
+        double transmitted_kb = 0.0;
+        int64_t in_flight_attempts = 0;
+        int64_t pruned_attempts = 0; // Dropped by BroadcastMode::Lazy.
+    };
+    BroadcastStats last_broadcast;
+
+    // Optional per-step time series output (not owned).
+    MetricsSink *metrics = nullptr;
+
+    // Per-phase timing, reset by run_experiment.
+    PhaseProfiler profiler;
+
+    // Optional event trace (not owned).
+    EventTracer *events = nullptr;
+
+    // Golden digest mode: per-step counts folded into run_digest by run_experiment.
+    bool digest_mode = false;
+    RunDigest run_digest;
+
+    BroadcastMode broadcast_mode = BroadcastMode::Reference;
+
+
+    // Parallel broadcast (see set_threads): the worker pool and each worker's scratch.
+    struct HotAttempt
     {
-        if (row >= known.at(peer).size() || col >= known.at(peer)[row].size())
+        int attempt;  // Index in the tx's attempt list.
+        int receiver;
+        int sender;
+        bool delivers; // Decided by the budget pass.
+    };
+    struct WorkerScratch
+    {
+        std::vector<double> load;                           // Per sender: KB due this step.
+        std::vector<char> knew_at_start;                    // Per attempt of the shard: receiver knew the tx.
+        std::vector<HotAttempt> hot;                        // Due attempts of hot senders, per tx in order.
+        std::vector<size_t> hot_offsets;                    // Per tx of the shard, into hot.
+        std::vector<char> claimed;                          // Per peer: an earlier cold attempt delivers to it.
+        std::vector<int> claimed_peers;                     // Peers set in claimed for the current tx.
+        std::vector<std::vector<std::pair<int, int>>> outbox; // Per peer partition: (receiver, tx id).
+        std::vector<std::pair<int, int>> deliveries;        // (receiver, attempt index), per tx in order.
+        std::vector<size_t> delivery_offsets;               // Per tx of the shard, into deliveries.
+        std::vector<int> delivered_at;                      // Per peer: attempt index of this tx's delivery.
+        std::vector<std::pair<int, bool>> arrivals;
+        std::vector<DeliveryAttempt> next_attempts;
+        CoverageHistograms peer_latency, validator_latency;
+        BroadcastStats stats;
+    };
+    struct ParallelState
+    {
+        WorkerPool pool;
+        std::vector<WorkerScratch> scratch;
+        std::vector<char> hot_sender;     // Per sender: may reach its limit this step.
+        std::vector<double> transmitted;  // Per sender: KB committed by the budget pass.
+        std::vector<char> taken;          // Per peer: delivered by a hot attempt of the current tx.
+        explicit ParallelState(int threads) : pool(threads), scratch(pool.size()) {}
+    };
+    std::shared_ptr<ParallelState> parallel;
+    int parallel_steps = 0; // Broadcast steps run by broadcast_parallel, reset by run_experiment.
+
+    // Warm-up detection on block publications, restarted by run_experiment.
+    SteadyStateDetector steady_state;
+
+    // Snapshot layout (see snapshot.hpp): section ids and fixed-width records.
+    static constexpr uint32_t SNAPSHOT_VERSION = 1;
+    enum SnapshotSectionId : uint32_t
+    {
+        SNAP_SCALARS = 1,           // SnapshotScalars
+        SNAP_CONNECTION_OFFSETS,    // uint32 per peer + 1 (CSR offsets into SNAP_CONNECTIONS)
+        SNAP_CONNECTIONS,           // SnapshotLink
+        SNAP_CONNECTION_COUNT,      // int32 per peer
+        SNAP_IS_VALIDATOR,          // uint8 per peer
+        SNAP_VALIDATOR_IDS,         // int32
+        SNAP_TX_SIZE_KB,            // int32 per tx id
+        SNAP_TX_INJECT_MS,          // int32 per tx id
+        SNAP_TX_KNOWN_PEERS,        // uint32 per tx id
+        SNAP_TX_KNOWN_VALIDATORS,   // uint16 per tx id
+        SNAP_FORCED_DELAY_MARKS,    // int32 pairs
+        SNAP_PROPOSED,              // int32 pairs (id, size_kb)
+        SNAP_IN_FLIGHT,             // SnapshotInFlight
+        SNAP_ATTEMPTS,              // SnapshotAttempt
+        SNAP_SET_CONTAINERS,        // SnapshotContainer; set num_peers is pending_tx_ids
+        SNAP_SET_DATA,              // uint64 words: array offsets (padded) or bitmaps
+        SNAP_RNG,                   // std::mt19937 state as text
+        SNAP_ANALYTIC               // SnapshotAnalytic
+    };
+
+    struct SnapshotScalars
+    {
+        int64_t num_peers, next_tx_id, publish_attempt_counter, total_injected, total_published_global, M;
+        int64_t network_time_ms, forced_delay_ms, known_rows, known_cols, current_proposed_block_size_kb;
+        int64_t total_published_size_kb, tx_size_min, tx_size_max;
+        uint64_t rng_seed;
+    };
+    struct SnapshotLink
+    {
+        int32_t peer, delay_ms;
+    };
+    struct SnapshotInFlight
+    {
+        int32_t tx_id, size_kb;
+        uint32_t first_attempt, attempt_count;
+    };
+    struct SnapshotAttempt
+    {
+        int32_t sender, receiver, timer, delay_ms;
+    };
+    struct SnapshotAnalytic
+    {
+        int32_t tx_id, size_kb, seed, steps, step_ms;
+        uint32_t cursor;
+    };
+    struct SnapshotContainer
+    {
+        uint32_t set, block, cardinality, is_bitmap;
+        uint64_t first_word; // Into SNAP_SET_DATA.
+    };
+
+    // Helper: Start a new measurement window on the current state: published counters,
+    // latency histograms and the inclusion sketch restart; the mempool and in-flight
+    // attempts are kept (pending count is unchanged).
+    void reset_measurements()
+    {
+        total_injected = get_pending_count();
+        total_published_global = 0;
+        total_published_size_kb = 0;
+        for (auto &h : peer_coverage_latency)
+            h.clear();
+        for (auto &h : validator_coverage_latency)
+            h.clear();
+        inclusion_latency.clear();
+    }
+
+    // Helper: Assert that tx_id fits the configured known capacity (known_rows x known_cols).
+    void assert_known_bounds(int peer, int tx_id) const
+    {
+        if (peer < 0 || peer >= num_peers || tx_id < 0 ||
+            static_cast<long long>(tx_id) >= static_cast<long long>(known_rows) * known_cols)
         {
-            std::print("Error: Known bounds check failed for peer {} at position ({}, {})\n", peer, row, col);
+            std::print("Error: Known bounds check failed for peer {} at tx {}\n", peer, tx_id);
             std::abort();
         }
     }
 
+    // Helper: Number of proposed transactions known by each validator (aligned with validator_ids).
+    std::vector<uint64_t> validator_coverage_counts() const
+    {
+        std::vector<const KnownSet *> sets;
+        sets.reserve(topology->validator_ids.size());
+        for (int v : topology->validator_ids)
+            sets.push_back(&known[v]);
+        std::vector<uint64_t> counts(topology->validator_ids.size(), 0);
+        KnownSet::and_cardinality_many(proposed_ids, sets.data(), sets.size(), counts.data());
+        return counts;
+    }
+
+    // Helper: Topology for writing; copies it first if a fork still shares it.
+    Topology &own_topology()
+    {
+        if (topology.use_count() > 1)
+            topology = std::make_shared<Topology>(*topology);
+        seed_schedules.clear();
+        return *topology;
+    }
+
+    // Helper: Cache non-validator peers (transaction seeds) and the coverage targets.
+    void update_seed_peers()
+    {
+        own_topology();
+        topology->seed_peers.clear();
+        for (int p = 0; p < num_peers; ++p)
+            if (!topology->isValidator[p])
+                topology->seed_peers.push_back(p);
+        int num_validators = num_peers - static_cast<int>(topology->seed_peers.size());
+        for (size_t k = 0; k < COVERAGE_FRACTIONS.size(); ++k)
+        {
+            peer_coverage_target[k] = std::max(1, static_cast<int>(std::ceil(COVERAGE_FRACTIONS[k] * num_peers)));
+            validator_coverage_target[k] = std::max(1, static_cast<int>(std::ceil(COVERAGE_FRACTIONS[k] * num_validators)));
+        }
+    }
+
+    // Helper: Count one more peer knowing tx_id since at_ms and record any coverage level it
+    // completes. Arrivals of one tx must be counted in time order.
+    void count_arrival(int tx_id, bool validator, int at_ms)
+    {
+        count_arrival(tx_id, validator, at_ms, peer_coverage_latency, validator_coverage_latency);
+    }
+
+    // count_arrival into the given histograms (a worker's own, in broadcast_parallel).
+    void count_arrival(int tx_id, bool validator, int at_ms, CoverageHistograms &peer_latency,
+                       CoverageHistograms &validator_latency)
+    {
+        uint32_t peers = ++tx_known_peers.mut(tx_id);
+        uint32_t validators = validator ? ++tx_known_validators.mut(tx_id) : 0;
+        int latency = at_ms - tx_inject_ms[tx_id];
+        for (size_t k = 0; k < COVERAGE_FRACTIONS.size(); ++k)
+        {
+            if (peers == peer_coverage_target[k])
+                peer_latency[k].record(latency);
+            if (validators == validator_coverage_target[k])
+                validator_latency[k].record(latency);
+        }
+    }
+
     // Helper: Update published size using current proposed block size.
     void updatePublishedSize()
     {
@@ -167,26 +567,54 @@ private:
         current_proposed_block_size_kb = 0;
     }
 
+    // Helper: Forced-publish stall accumulated before network time t_ms.
+    int forced_delay_before(int t_ms) const
+    {
+        auto it = std::upper_bound(forced_delay_marks.begin(), forced_delay_marks.end(), std::pair<int, int>(t_ms, INT_MAX));
+        return it == forced_delay_marks.begin() ? 0 : std::prev(it)->second;
+    }
+
+    // Helper: Feed inclusion latency of every proposed transaction, published now.
+    void record_inclusion_latency()
+    {
+        const int now = network_time_ms + forced_delay_ms;
+        for (const auto &tx : proposed_transactions)
+        {
+            int injected = tx_inject_ms[tx.id];
+            inclusion_latency.add(now - (injected + forced_delay_before(injected)));
+        }
+    }
+
     // Helper: Clear published proposals from pending sets and global_pending.
     void updateAndCleanAfterPublishedCompleted(bool debug, double threshold)
     {
         int published_count = proposed_transactions.size();
         if (debug)
         {
-            std::print("Published {} transactions. Cleared them from pending set and global_pending.\n", published_count);
+            log_info("Published {} transactions. Cleared them from pending set and global_pending.\n", published_count);
             print_publish_request_summary(threshold);
         }
+        record_inclusion_latency();
         total_published_size_kb += current_proposed_block_size_kb;
-        for (const auto &tx : proposed_transactions)
-        {
-            pending_tx_ids.erase(tx.id);
-            tx_lookup.erase(tx.id);
-        }
+        pending_tx_ids.and_not(proposed_ids);
         total_published_global += published_count;
         global_pending.erase(std::remove_if(global_pending.begin(), global_pending.end(),
                                             [&](const GlobalPendingTx &gpt)
-                                            { return proposed_ids.count(gpt.tx.id) > 0; }),
+                                            { return proposed_ids.test(gpt.tx.id); }),
                              global_pending.end());
+        std::erase_if(analytic_pending, [&](const AnalyticTx &at)
+                      { return proposed_ids.test(at.tx.id); });
+        for (auto &cohort : cohorts)
+        {
+            if (std::erase_if(cohort.tx_ids, [&](int id)
+                              { return proposed_ids.test(id); }) == 0)
+                continue;
+            cohort.size_kb = 0;
+            for (int id : cohort.tx_ids)
+                cohort.size_kb += tx_size_kb[id];
+        }
+        std::erase_if(cohorts, [](const Cohort &cohort)
+                      { return cohort.tx_ids.empty(); });
         proposed_transactions.clear();
         current_proposed_block_size_kb = 0;
         publish_attempt_counter = 0;
@@ -209,6 +637,99 @@ public:
         tx_size_max = max_size;
     }
 
+    void set_verbose(bool on)
+    {
+        verbose = on;
+    }
+
+    // Record a StepMetrics row after every run_experiment step (nullptr to disable).
+    void set_metrics_sink(MetricsSink *sink)
+    {
+        metrics = sink;
+    }
+
+    // Digest mode: run_experiment fingerprints every step's pending and published counts and
+    // the final known sets into ExperimentResult::digest, to verify optimized engines
+    // against the reference bit for bit.
+    void set_digest_mode(bool enabled)
+    {
+        digest_mode = enabled;
+    }
+
+    // Broadcast attempt tracking (see BroadcastMode).
+    void set_broadcast_mode(BroadcastMode mode)
+    {
+        broadcast_mode = mode;
+    }
+
+    // Worker threads for broadcast (see broadcast_parallel); 1 runs it on the calling thread
+    // only. Results are identical for any thread count.
+    void set_threads(int threads)
+    {
+        parallel = threads > 1 ? std::make_shared<ParallelState>(threads) : nullptr;
+    }
+
+    // Steady-state detection window and tolerances; with stop_on_convergence,
+    // run_experiment ends once the steady throughput estimate has converged.
+    void set_steady_state_config(const SteadyStateConfig &config)
+    {
+        steady_state.configure(config);
+    }
+
+    // Fold every peer's known set (ids in ascending order) into digest.
+    void digest_known_sets(RunDigest &digest) const
+    {
+        for (const auto &k : known)
+        {
+            digest.add(k.cardinality());
+            k.for_each([&](int tx_id)
+                       { digest.add(static_cast<uint64_t>(tx_id)); });
+        }
+    }
+
+    // Digest of one peer's known set, as digest_known_sets folds it.
+    uint64_t known_digest(int peer) const
+    {
+        RunDigest digest;
+        digest.add(known[peer].cardinality());
+        known[peer].for_each([&](int tx_id)
+                             { digest.add(static_cast<uint64_t>(tx_id)); });
+        return digest.value();
+    }
+
+    // Record injections, deliveries, proposals, publishes and phase timings into tracer
+    // (nullptr to stop). Call after select_validators so tracks are named by role.
+    void set_event_tracer(EventTracer *tracer)
+    {
+        events = tracer;
+        if (!events)
+            return;
+        for (int p = 0; p < num_peers; ++p)
+            events->set_track_name(p, std::format("{} {}", topology->isValidator[p] ? "validator" : "peer", p));
+    }
+
+    // Time series row for the current state; coverage uses the popcount kernel, so it is
+    // only computed when asked for.
+    StepMetrics current_step_metrics(int time_ms) const
+    {
+        StepMetrics m;
+        m.time_ms = time_ms;
+        m.pending = get_pending_count();
+        m.in_flight_attempts = last_broadcast.in_flight_attempts;
+        m.deliveries = last_broadcast.deliveries;
+        m.throttled_attempts = last_broadcast.throttled_attempts;
+        m.transmitted_kb = last_broadcast.transmitted_kb;
+        m.published_total = total_published_global;
+        if (!proposed_transactions.empty() && !topology->validator_ids.empty())
+        {
+            uint64_t known_total = 0;
+            for (uint64_t c : validator_coverage_counts())
+                known_total += c;
+            m.coverage_pct = known_total * 100.0 / (static_cast<double>(proposed_transactions.size()) * topology->validator_ids.size());
+        }
+        return m;
+    }
+
     //////////////////////////
     // Public Methods
     //////////////////////////
@@ -227,30 +748,372 @@ public:
         total_injected = 0;
         total_published_global = 0;
         global_pending.clear();
+        analytic_pending.clear();
+        cohorts.clear();
+        attempts_fallback = false;
         total_published_size_kb = 0;
         current_proposed_block_size_kb = 0;
         pending_tx_ids.clear();
-        tx_lookup.clear();
-        for (auto &p : known)
+        tx_size_kb.clear();
+        network_time_ms = 0;
+        tx_inject_ms.clear();
+        tx_known_peers.clear();
+        tx_known_validators.clear();
+        for (auto &h : peer_coverage_latency)
+            h.clear();
+        for (auto &h : validator_coverage_latency)
+            h.clear();
+        forced_delay_ms = 0;
+        forced_delay_marks.clear();
+        inclusion_latency.clear();
+        for (auto &k : known)
+            k.clear();
+        log_info("Network transactions cleared. next_tx_id reset to {}.\n", next_tx_id);
+    }
+
+    //////////////////////////
+    // Snapshot and Restore
+    //////////////////////////
+
+    // Write topology, known sets, pending and in-flight transactions, the current proposal
+    // and RNG state to path (format: snapshot.hpp). Latency histograms are measurements,
+    // not state, and are not saved.
+    bool save_snapshot(const std::string &path) const
+    {
+        SnapshotWriter writer(SNAPSHOT_VERSION);
+        SnapshotScalars scalars{num_peers, next_tx_id, publish_attempt_counter, total_injected, total_published_global, M,
+                                network_time_ms, forced_delay_ms, known_rows, known_cols, current_proposed_block_size_kb,
+                                total_published_size_kb, tx_size_min, tx_size_max, rng_seed};
+        writer.add_bytes(SNAP_SCALARS, &scalars, sizeof(scalars));
+
+        std::vector<uint32_t> offsets{0};
+        std::vector<SnapshotLink> links;
+        for (const auto &list : topology->connections)
+        {
+            for (const auto &c : list)
+                links.push_back({c.peer, c.delay_ms});
+            offsets.push_back(static_cast<uint32_t>(links.size()));
+        }
+        writer.add(SNAP_CONNECTION_OFFSETS, offsets);
+        writer.add(SNAP_CONNECTIONS, links);
+        writer.add(SNAP_CONNECTION_COUNT, topology->connection_count);
+        writer.add(SNAP_IS_VALIDATOR, std::vector<uint8_t>(topology->isValidator.begin(), topology->isValidator.end()));
+        writer.add(SNAP_VALIDATOR_IDS, topology->validator_ids);
+
+        writer.add(SNAP_TX_SIZE_KB, tx_size_kb.to_vector());
+        writer.add(SNAP_TX_INJECT_MS, tx_inject_ms.to_vector());
+        writer.add(SNAP_TX_KNOWN_PEERS, tx_known_peers.to_vector());
+        writer.add(SNAP_TX_KNOWN_VALIDATORS, tx_known_validators.to_vector());
+        std::vector<int32_t> marks;
+        for (const auto &[at_ms, delay_ms] : forced_delay_marks)
+            marks.insert(marks.end(), {at_ms, delay_ms});
+        writer.add(SNAP_FORCED_DELAY_MARKS, marks);
+        std::vector<int32_t> proposed;
+        for (const auto &tx : proposed_transactions)
+            proposed.insert(proposed.end(), {tx.id, tx.size_kb});
+        writer.add(SNAP_PROPOSED, proposed);
+
+        // Cohorts are written as their single txs (in tx id order), sharing one attempt range.
+        std::vector<std::pair<Transaction, const std::vector<DeliveryAttempt> *>> flights;
+        for (const auto &gpt : global_pending)
+            flights.emplace_back(gpt.tx, &gpt.attempts);
+        for (const auto &cohort : cohorts)
+            for (int id : cohort.tx_ids)
+                flights.emplace_back(Transaction(id, tx_size_kb[id]), &cohort.attempts);
+        std::stable_sort(flights.begin(), flights.end(), [](const auto &a, const auto &b)
+                         { return a.first.id < b.first.id; });
+        std::vector<SnapshotInFlight> in_flight;
+        std::vector<SnapshotAttempt> attempts;
+        std::unordered_map<const std::vector<DeliveryAttempt> *, uint32_t> first_attempt;
+        for (const auto &[tx, list] : flights)
+        {
+            auto [it, added] = first_attempt.try_emplace(list, static_cast<uint32_t>(attempts.size()));
+            if (added)
+                for (const auto &a : *list)
+                    attempts.push_back({a.sender, a.receiver, a.timer, a.delay_ms});
+            in_flight.push_back({tx.id, tx.size_kb, it->second, static_cast<uint32_t>(list->size())});
+        }
+        writer.add(SNAP_IN_FLIGHT, in_flight);
+        writer.add(SNAP_ATTEMPTS, attempts);
+        std::vector<SnapshotAnalytic> analytic;
+        for (const auto &at : analytic_pending)
+            analytic.push_back({at.tx.id, at.tx.size_kb, at.seed, at.steps, analytic_step_ms, at.cursor});
+        writer.add(SNAP_ANALYTIC, analytic);
+
+        std::vector<SnapshotContainer> containers;
+        std::vector<uint64_t> words;
+        auto add_set = [&](uint32_t set, const KnownSet &ks)
+        {
+            ks.for_each_container([&](size_t block, const KnownSet::Container &c)
+                                  {
+                containers.push_back({set, static_cast<uint32_t>(block), c.cardinality, c.is_bitmap(), words.size()});
+                if (c.is_bitmap())
+                    words.insert(words.end(), c.bitmap.get(), c.bitmap.get() + KnownSet::BLOCK_WORDS);
+                else
+                {
+                    size_t first = words.size();
+                    words.resize(first + (c.array.size() * sizeof(uint16_t) + 7) / 8, 0);
+                    std::memcpy(words.data() + first, c.array.data(), c.array.size() * sizeof(uint16_t));
+                } });
+        };
+        for (int p = 0; p < num_peers; ++p)
+            add_set(static_cast<uint32_t>(p), known[p]);
+        add_set(static_cast<uint32_t>(num_peers), pending_tx_ids);
+        writer.add(SNAP_SET_CONTAINERS, containers);
+        writer.add(SNAP_SET_DATA, words);
+
+        std::ostringstream rng;
+        rng << engine;
+        writer.add_bytes(SNAP_RNG, rng.str().data(), rng.str().size());
+        return writer.write(path);
+    }
+
+    // Replace the whole network state with a snapshot from save_snapshot. Configuration
+    // that is not simulation state (verbosity, metrics sink, tracer, digest mode) is kept.
+    // On error the network is left unchanged.
+    bool load_snapshot(const std::string &path)
+    {
+        SnapshotReader reader;
+        if (!reader.open(path, SNAPSHOT_VERSION))
+            return false;
+        size_t n_scalars, n_offsets, n_links, n_in_flight, n_attempts, n_analytic, n_containers, n_words, n_rng;
+        const auto *scalars = reader.view<SnapshotScalars>(SNAP_SCALARS, n_scalars);
+        const auto *offsets = reader.view<uint32_t>(SNAP_CONNECTION_OFFSETS, n_offsets);
+        const auto *links = reader.view<SnapshotLink>(SNAP_CONNECTIONS, n_links);
+        const auto *in_flight = reader.view<SnapshotInFlight>(SNAP_IN_FLIGHT, n_in_flight);
+        const auto *attempts = reader.view<SnapshotAttempt>(SNAP_ATTEMPTS, n_attempts);
+        const auto *analytic = reader.view<SnapshotAnalytic>(SNAP_ANALYTIC, n_analytic);
+        const auto *containers = reader.view<SnapshotContainer>(SNAP_SET_CONTAINERS, n_containers);
+        const auto *words = reader.view<uint64_t>(SNAP_SET_DATA, n_words);
+        const auto *rng_text = reader.view<char>(SNAP_RNG, n_rng);
+
+        // Validate everything before touching the network.
+        auto fail = [&](const char *what)
+        {
+            std::print("Error: snapshot {}: {}.\n", path, what);
+            return false;
+        };
+        if (n_scalars != 1)
+            return fail("missing scalars");
+        const SnapshotScalars &sc = *scalars;
+        const size_t peers = static_cast<size_t>(sc.num_peers), txs = static_cast<size_t>(sc.next_tx_id);
+        if (n_offsets != peers + 1 || offsets[peers] != n_links)
+            return fail("bad connection table");
+        for (size_t i = 0; i < n_links; ++i)
+            if (links[i].peer < 0 || static_cast<size_t>(links[i].peer) >= peers)
+                return fail("bad connection table");
+        if (reader.count<int32_t>(SNAP_CONNECTION_COUNT) != peers || reader.count<uint8_t>(SNAP_IS_VALIDATOR) != peers)
+            return fail("bad per-peer section");
+        if (reader.count<int32_t>(SNAP_TX_SIZE_KB) != txs || reader.count<int32_t>(SNAP_TX_INJECT_MS) != txs ||
+            reader.count<uint32_t>(SNAP_TX_KNOWN_PEERS) != txs || reader.count<uint16_t>(SNAP_TX_KNOWN_VALIDATORS) != txs)
+            return fail("bad per-transaction section");
+        auto is_peer = [&](int32_t p)
+        { return p >= 0 && static_cast<size_t>(p) < peers; };
+        auto is_tx = [&](int32_t id)
+        { return id >= 0 && static_cast<size_t>(id) < txs; };
+        size_t n_validator_ids, n_proposed;
+        const auto *validator_ids = reader.view<int32_t>(SNAP_VALIDATOR_IDS, n_validator_ids);
+        const auto *proposed_pairs = reader.view<int32_t>(SNAP_PROPOSED, n_proposed);
+        for (size_t i = 0; i < n_validator_ids; ++i)
+            if (!is_peer(validator_ids[i]))
+                return fail("bad validator list");
+        if (n_proposed % 2 != 0)
+            return fail("bad proposed block");
+        for (size_t i = 0; i < n_proposed; i += 2)
+            if (!is_tx(proposed_pairs[i]))
+                return fail("bad proposed block");
+        for (size_t i = 0; i < n_in_flight; ++i)
+            if (!is_tx(in_flight[i].tx_id) ||
+                in_flight[i].first_attempt + static_cast<uint64_t>(in_flight[i].attempt_count) > n_attempts)
+                return fail("bad in-flight table");
+        for (size_t i = 0; i < n_attempts; ++i)
+            if (!is_peer(attempts[i].sender) || !is_peer(attempts[i].receiver))
+                return fail("bad attempt table");
+        for (size_t i = 0; i < n_analytic; ++i)
+            if (!is_tx(analytic[i].tx_id) || !is_peer(analytic[i].seed) || analytic[i].cursor >= peers ||
+                analytic[i].step_ms != analytic[0].step_ms)
+                return fail("bad analytic table");
+        for (size_t i = 0; i < n_containers; ++i)
+        {
+            const SnapshotContainer &c = containers[i];
+            uint64_t n = c.is_bitmap ? KnownSet::BLOCK_WORDS : (c.cardinality * sizeof(uint16_t) + 7) / 8;
+            if (c.set > peers || c.cardinality > static_cast<uint32_t>(KnownSet::BLOCK_BITS) || c.first_word + n > n_words ||
+                static_cast<uint64_t>(c.block) * KnownSet::BLOCK_BITS >= txs)
+                return fail("bad known set table");
+            // Array containers hold ascending offsets without duplicates.
+            if (!c.is_bitmap)
+            {
+                const auto *values = reinterpret_cast<const uint16_t *>(words + c.first_word);
+                for (uint32_t k = 1; k < c.cardinality; ++k)
+                    if (values[k] <= values[k - 1])
+                        return fail("bad known set table");
+            }
+        }
+        std::istringstream rng(std::string(rng_text ? rng_text : "", n_rng));
+        std::mt19937 restored_engine;
+        if (!(rng >> restored_engine))
+            return fail("bad RNG state");
+
+        num_peers = static_cast<int>(sc.num_peers);
+        next_tx_id = static_cast<int>(sc.next_tx_id);
+        publish_attempt_counter = static_cast<int>(sc.publish_attempt_counter);
+        total_injected = static_cast<int>(sc.total_injected);
+        total_published_global = static_cast<int>(sc.total_published_global);
+        M = static_cast<int>(sc.M);
+        network_time_ms = static_cast<int>(sc.network_time_ms);
+        forced_delay_ms = static_cast<int>(sc.forced_delay_ms);
+        known_rows = static_cast<int>(sc.known_rows);
+        known_cols = static_cast<int>(sc.known_cols);
+        current_proposed_block_size_kb = static_cast<int>(sc.current_proposed_block_size_kb);
+        total_published_size_kb = static_cast<int>(sc.total_published_size_kb);
+        tx_size_min = static_cast<int>(sc.tx_size_min);
+        tx_size_max = static_cast<int>(sc.tx_size_max);
+        rng_seed = sc.rng_seed;
+        engine = restored_engine;
+
+        topology = std::make_shared<Topology>();
+        seed_schedules.clear();
+        topology->connections.assign(num_peers, {});
+        for (int p = 0; p < num_peers; ++p)
+            for (uint32_t i = offsets[p]; i < offsets[p + 1]; ++i)
+                topology->connections[p].emplace_back(links[i].peer, links[i].delay_ms);
+        topology->connection_count = reader.copy<int>(SNAP_CONNECTION_COUNT);
+        auto validator_flags = reader.copy<uint8_t>(SNAP_IS_VALIDATOR);
+        topology->isValidator.assign(validator_flags.begin(), validator_flags.end());
+        topology->validator_ids = reader.copy<int>(SNAP_VALIDATOR_IDS);
+        update_seed_peers();
+
+        auto restore = [&]<typename T>(CowVector<T> &out, uint32_t id)
+        {
+            size_t n;
+            const T *values = reader.view<T>(id, n);
+            out.clear();
+            out.append(values, n);
+        };
+        restore(tx_size_kb, SNAP_TX_SIZE_KB);
+        restore(tx_inject_ms, SNAP_TX_INJECT_MS);
+        restore(tx_known_peers, SNAP_TX_KNOWN_PEERS);
+        restore(tx_known_validators, SNAP_TX_KNOWN_VALIDATORS);
+        auto marks = reader.copy<int32_t>(SNAP_FORCED_DELAY_MARKS);
+        forced_delay_marks.clear();
+        for (size_t i = 0; i + 1 < marks.size(); i += 2)
+            forced_delay_marks.emplace_back(marks[i], marks[i + 1]);
+        auto proposed = reader.copy<int32_t>(SNAP_PROPOSED);
+        proposed_transactions.clear();
+        proposed_ids.clear();
+        for (size_t i = 0; i + 1 < proposed.size(); i += 2)
+        {
+            proposed_transactions.emplace_back(proposed[i], proposed[i + 1]);
+            proposed_ids.set(proposed[i]);
+        }
+
+        global_pending.clear();
+        global_pending.reserve(n_in_flight);
+        for (size_t i = 0; i < n_in_flight; ++i)
+        {
+            GlobalPendingTx &gpt = global_pending.emplace_back(Transaction(in_flight[i].tx_id, in_flight[i].size_kb), -1);
+            gpt.attempts.reserve(in_flight[i].attempt_count);
+            for (uint32_t j = 0; j < in_flight[i].attempt_count; ++j)
+            {
+                const SnapshotAttempt &a = attempts[in_flight[i].first_attempt + j];
+                gpt.attempts.emplace_back(a.sender, a.receiver, a.delay_ms).timer = a.timer;
+            }
+        }
+        analytic_pending.clear();
+        for (size_t i = 0; i < n_analytic; ++i)
+        {
+            const SnapshotAnalytic &a = analytic[i];
+            analytic_pending.push_back({Transaction(a.tx_id, a.size_kb), a.seed, a.steps, a.cursor});
+        }
+        analytic_step_ms = n_analytic ? analytic[0].step_ms : 0;
+        cohorts.clear();
+        attempts_fallback = false;
+
+        known.clear();
+        known.resize(num_peers);
+        pending_tx_ids.clear();
+        for (size_t i = 0; i < n_containers; ++i)
         {
-            p.second.assign(known_rows, std::vector<bool>(known_cols, false));
+            const SnapshotContainer &c = containers[i];
+            KnownSet &set = c.set == peers ? pending_tx_ids : known[c.set];
+            const uint64_t *data = words + c.first_word;
+            if (c.is_bitmap)
+                set.load_container(c.block, c.cardinality, nullptr, data);
+            else
+                set.load_container(c.block, c.cardinality, reinterpret_cast<const uint16_t *>(data), nullptr);
         }
-        std::print("Network transactions cleared. next_tx_id reset to {}.\n", next_tx_id);
+
+        for (auto &h : peer_coverage_latency)
+            h.clear();
+        for (auto &h : validator_coverage_latency)
+            h.clear();
+        inclusion_latency.clear();
+        last_broadcast = {};
+        log_info("Restored snapshot {}: {} peers, {} pending transactions.\n", path, num_peers, get_pending_count());
+        return true;
     }
 
     //////////////////////////
     // Connection Generation
     //////////////////////////
+    int get_num_peers() const
+    {
+        return num_peers;
+    }
+
+    // Bytes held by the known and pending sets; with exclusive_only, blocks still shared
+    // with a fork (or its parent) are left out.
+    size_t known_memory_bytes(bool exclusive_only = false) const
+    {
+        size_t bytes = pending_tx_ids.memory_bytes(exclusive_only);
+        for (const auto &k : known)
+            bytes += k.memory_bytes(exclusive_only);
+        return bytes;
+    }
+
+    // Peers reachable from center in at most hops links (including center), e.g. to
+    // describe a regional hotspot for HotspotSeeds.
+    std::vector<int> peers_within_hops(int center, int hops) const
+    {
+        std::vector<int> dist(num_peers, -1);
+        std::vector<int> region{center};
+        dist[center] = 0;
+        for (size_t head = 0; head < region.size(); ++head)
+        {
+            int p = region[head];
+            if (dist[p] == hops)
+                continue;
+            for (const auto &c : topology->connections[p])
+            {
+                if (dist[c.peer] < 0)
+                {
+                    dist[c.peer] = dist[p] + 1;
+                    region.push_back(c.peer);
+                }
+            }
+        }
+        return region;
+    }
+
+    bool is_connected(int peer1, int peer2) const
+    {
+        for (const auto &c : topology->connections[peer1])
+            if (c.peer == peer2)
+                return true;
+        return false;
+    }
+
     bool add_connection(int peer1, int peer2, int delay, int max_connections)
     {
-        if (connections[peer1].find(peer2) != connections[peer1].end())
+        if (is_connected(peer1, peer2))
             return false;
-        if (connection_count[peer1] >= max_connections || connection_count[peer2] >= max_connections)
+        own_topology();
+        if (topology->connection_count[peer1] >= max_connections || topology->connection_count[peer2] >= max_connections)
             return false;
-        connections[peer1][peer2] = Connection(delay);
-        connections[peer2][peer1] = Connection(delay);
-        connection_count[peer1]++;
-        connection_count[peer2]++;
+        topology->connections[peer1].push_back(Connection(peer2, delay));
+        topology->connections[peer2].push_back(Connection(peer1, delay));
+        topology->connection_count[peer1]++;
+        topology->connection_count[peer2]++;
         return true;
     }
 
@@ -260,18 +1123,22 @@ public:
     {
         std::uniform_int_distribution<int> connection_distribution(min_connections, max_connections);
         std::normal_distribution<double> delay_distribution(100.0, 50.0);
-        for (int i = 1; i <= num_peers; ++i)
-        {
-            connection_count[i] = 0;
-            isValidator[i] = false;
-            known[i] = std::vector<std::vector<bool>>(known_rows, std::vector<bool>(known_cols, false));
-        }
-        for (int i = 1; i <= num_peers; ++i)
+        this->num_peers = num_peers;
+        topology = std::make_shared<Topology>();
+        seed_schedules.clear();
+        topology->connections.assign(num_peers, {});
+        topology->connection_count.assign(num_peers, 0);
+        topology->isValidator.assign(num_peers, false);
+        known.clear();
+        known.resize(num_peers);
+        topology->validator_ids.clear();
+        update_seed_peers();
+        for (int i = 0; i < num_peers; ++i)
         {
             std::set<int> connected_peers;
             if (full_mesh)
             {
-                for (int j = i + 1; j <= num_peers; ++j)
+                for (int j = i + 1; j < num_peers; ++j)
                 {
                     int raw_delay = static_cast<int>(delay_distribution(engine));
                     int delay = std::clamp(raw_delay, delay_min, delay_max) * delay_multiplier;
@@ -285,14 +1152,14 @@ public:
                 int attempts = 0;
                 const int max_attempts = 1000;
                 while (connected_peers.size() < static_cast<size_t>(target_connections) &&
-                       connection_count[i] < max_connections &&
+                       topology->connection_count[i] < max_connections &&
                        attempts < max_attempts)
                 {
-                    int candidate = std::uniform_int_distribution<int>(1, num_peers)(engine);
+                    int candidate = std::uniform_int_distribution<int>(0, num_peers - 1)(engine);
                     if (candidate != i &&
                         connected_peers.find(candidate) == connected_peers.end() &&
-                        connections[i].find(candidate) == connections[i].end() &&
-                        connection_count[candidate] < max_connections)
+                        !is_connected(i, candidate) &&
+                        topology->connection_count[candidate] < max_connections)
                     {
                         int raw_delay = static_cast<int>(delay_distribution(engine));
                         int delay = std::clamp(raw_delay, delay_min, delay_max) * delay_multiplier;
@@ -310,138 +1177,786 @@ public:
     //////////////////////////
     void select_validators(int num_validators)
     {
-        std::vector<int> all_peers;
-        for (const auto &p : connection_count)
-            all_peers.push_back(p.first);
+        std::vector<int> all_peers(num_peers);
+        for (int p = 0; p < num_peers; ++p)
+            all_peers[p] = p;
         std::shuffle(all_peers.begin(), all_peers.end(), engine);
-        for (int i = 0; i < num_validators && i < static_cast<int>(all_peers.size()); ++i)
-            isValidator[all_peers[i]] = true;
-        validator_ids.clear();
-        for (const auto &p : isValidator)
+        own_topology();
+        for (int i = 0; i < num_validators && i < num_peers; ++i)
+            topology->isValidator[all_peers[i]] = true;
+        topology->validator_ids.clear();
+        for (int p = 0; p < num_peers; ++p)
         {
-            if (p.second)
-                validator_ids.push_back(p.first);
+            if (topology->isValidator[p])
+                topology->validator_ids.push_back(p);
         }
-        int total_validators = validator_ids.size();
+        int total_validators = topology->validator_ids.size();
         int f = (total_validators - 1) / 3;
         int required_validators = 2 * f + 1;
         if (required_validators < 1)
             required_validators = 1;
         M = required_validators;
+        update_seed_peers();
+    }
+
+    // Fill batch with sizes and seed peers for the next num_transactions ids. Draws come from
+    // counter-based streams keyed by tx id, four ids per Philox block, so the loop has no
+    // carried RNG state and the result does not depend on how injection is split up.
+    void generate_injection_batch(int num_transactions, InjectionBatch &batch) const
+    {
+        batch.resize(num_transactions);
+        if (num_transactions == 0 || topology->seed_peers.empty())
+            return;
+        fill_uniform_sizes(rng_seed, next_tx_id, num_transactions, tx_size_min, tx_size_max, batch.size_kb.data());
+        fill_uniform_seeds(rng_seed, next_tx_id, num_transactions, topology->seed_peers, batch.seed.data());
     }
 
-    // Inject transactions: record in tx_lookup and pending_tx_ids; mark known for the seed.
+    // Inject a prepared batch: append sizes to the dense store, mark pending and known
+    // for the seed, and open delivery attempts to the seed's neighbors.
+    void inject_batch(const InjectionBatch &batch)
+    {
+        int n = static_cast<int>(batch.size());
+        if (n == 0)
+            return;
+        assert_known_bounds(batch.seed[n - 1], next_tx_id + n - 1);
+        const Topology &topo = *topology;
+        tx_size_kb.append(batch.size_kb.data(), n);
+        tx_inject_ms.append(n, network_time_ms);
+        tx_known_peers.append(n, 0);
+        tx_known_validators.append(n, 0);
+        const bool analytic = broadcast_mode == BroadcastMode::Analytic && !attempts_fallback;
+        const bool cohort = broadcast_mode == BroadcastMode::Cohort && !attempts_fallback;
+        std::vector<int> cohort_of_seed(cohort ? num_peers : 0, -1);
+        if (analytic)
+            analytic_pending.reserve(analytic_pending.size() + n);
+        else if (!cohort)
+            global_pending.reserve(global_pending.size() + n);
+        for (int i = 0; i < n; ++i)
+        {
+            int id = next_tx_id++;
+            int seed = batch.seed[i];
+            pending_tx_ids.set(id);
+            known[seed].set(id);
+            count_arrival(id, topo.isValidator[seed], network_time_ms);
+            if (events)
+                events->inject(network_time_ms, seed, id);
+            if (analytic)
+            {
+                analytic_pending.push_back({Transaction(id, batch.size_kb[i]), seed, 0, 0});
+                continue;
+            }
+            if (cohort)
+            {
+                if (cohort_of_seed[seed] < 0)
+                {
+                    cohort_of_seed[seed] = static_cast<int>(cohorts.size());
+                    Cohort &created = cohorts.emplace_back();
+                    created.attempts.reserve(topo.connections[seed].size());
+                    for (const auto &c : topo.connections[seed])
+                        created.attempts.push_back(DeliveryAttempt(seed, c.peer, c.delay_ms));
+                }
+                Cohort &group = cohorts[cohort_of_seed[seed]];
+                group.tx_ids.push_back(id);
+                group.size_kb += batch.size_kb[i];
+                continue;
+            }
+            GlobalPendingTx &gpt = global_pending.emplace_back(Transaction(id, batch.size_kb[i]), seed);
+            gpt.attempts.reserve(topo.connections[seed].size());
+            for (const auto &c : topo.connections[seed])
+                gpt.attempts.push_back(DeliveryAttempt(seed, c.peer, c.delay_ms));
+        }
+    }
+
+    // Inject the transactions a workload generates for [start_ms, start_ms + step_ms).
+    void inject_workload(Workload &workload, int start_ms, int step_ms)
+    {
+        ScopedPhaseTimer timer(profiler, Phase::Inject);
+        EventTracer::Span span(events, Phase::Inject);
+        WorkloadContext ctx{rng_seed, next_tx_id, num_peers, tx_size_min, tx_size_max, topology->seed_peers};
+        workload.generate(ctx, start_ms, step_ms, injection_batch);
+        timer.items(injection_batch.size());
+        log_info("Injecting {} transactions.\n", injection_batch.size());
+        total_injected += static_cast<int>(injection_batch.size());
+        inject_batch(injection_batch);
+    }
+
+    // Inject transactions: record sizes and pending ids; mark known for the seed.
     void inject_transactions(int num_transactions)
     {
-        std::print("Injecting {} transactions.\n", num_transactions);
+        ScopedPhaseTimer timer(profiler, Phase::Inject);
+        EventTracer::Span span(events, Phase::Inject);
+        timer.items(num_transactions);
+        log_info("Injecting {} transactions.\n", num_transactions);
         total_injected += num_transactions;
-        std::uniform_int_distribution<int> size_distribution(tx_size_min, tx_size_max);
-        std::vector<int> seed_peers;
-        for (const auto &p : isValidator)
-            if (!p.second)
-                seed_peers.push_back(p.first);
-        if (seed_peers.empty())
+        if (topology->seed_peers.empty())
             return;
-        std::uniform_int_distribution<int> peer_distribution(0, seed_peers.size() - 1);
-        for (int i = 0; i < num_transactions; ++i)
-        {
-            int tx_size = size_distribution(engine);
-            Transaction tx(next_tx_id++, tx_size);
-            tx_lookup.insert({tx.id, tx});
-            pending_tx_ids.insert(tx.id);
-            int seed = seed_peers[peer_distribution(engine)];
-            GlobalPendingTx gpt(tx, seed);
-            int row, col;
-            get_known_position(tx.id, row, col);
-            assert_known_bounds(seed, row, col);
-            known[seed][row][col] = true;
-            for (const auto &nPair : connections[seed])
+        generate_injection_batch(num_transactions, injection_batch);
+        inject_batch(injection_batch);
+    }
+
+    // Schedule of seed for analytic propagation, built on first use.
+    const SeedSchedule &seed_schedule(int seed)
+    {
+        if (seed_schedules.size() != static_cast<size_t>(num_peers))
+            seed_schedules.assign(num_peers, nullptr);
+        if (!seed_schedules[seed])
+            seed_schedules[seed] = build_seed_schedule(seed);
+        return *seed_schedules[seed];
+    }
+
+    // Dijkstra from seed in whole steps: an attempt opened when its sender learns in step k
+    // delivers in step k + ceil(delay / step) (at least one step later); the seed's own
+    // attempts also count the injection step, which is step 0 here.
+    std::shared_ptr<const SeedSchedule> build_seed_schedule(int seed) const
+    {
+        const Topology &topo = *topology;
+        const int step_ms = analytic_step_ms;
+        auto hop_steps = [&](int delay_ms)
+        { return std::max(1, (delay_ms + step_ms - 1) / step_ms); };
+        std::vector<int> learned(num_peers, INT_MAX);
+        std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<>> queue;
+        learned[seed] = 0;
+        queue.emplace(0, seed);
+        while (!queue.empty())
+        {
+            auto [k, u] = queue.top();
+            queue.pop();
+            if (k > learned[u])
+                continue;
+            for (const auto &c : topo.connections[u])
+            {
+                int at = k + hop_steps(c.delay_ms);
+                if (at < learned[c.peer])
+                {
+                    learned[c.peer] = at;
+                    queue.emplace(at, c.peer);
+                }
+            }
+        }
+
+        struct Entry
+        {
+            int step, arrival_ms, peer, sender, delay_ms;
+        };
+        std::vector<Entry> entries;
+        for (int r = 0; r < num_peers; ++r)
+        {
+            if (r == seed || learned[r] == INT_MAX)
+                continue;
+            Entry e{learned[r], INT_MAX, r, -1, 0};
+            for (const auto &c : topo.connections[r])
+            {
+                if (learned[c.peer] == INT_MAX || learned[c.peer] + hop_steps(c.delay_ms) != learned[r])
+                    continue;
+                int arrival = learned[c.peer] * step_ms + c.delay_ms;
+                if (arrival < e.arrival_ms)
+                {
+                    e.arrival_ms = arrival;
+                    e.sender = c.peer;
+                    e.delay_ms = c.delay_ms;
+                }
+            }
+            entries.push_back(e);
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+                  { return std::tie(a.step, a.arrival_ms, a.peer) < std::tie(b.step, b.arrival_ms, b.peer); });
+
+        auto schedule = std::make_shared<SeedSchedule>();
+        schedule->candidate_offsets.push_back(0);
+        for (const Entry &e : entries)
+        {
+            schedule->peer.push_back(e.peer);
+            schedule->step.push_back(e.step);
+            schedule->arrival_ms.push_back(e.arrival_ms);
+            schedule->sender.push_back(e.sender);
+            schedule->delay_ms.push_back(e.delay_ms);
+            for (const auto &c : topo.connections[e.peer])
+                if (learned[c.peer] != INT_MAX && learned[c.peer] + hop_steps(c.delay_ms) == e.step)
+                    schedule->candidates.push_back(c.peer);
+            schedule->candidate_offsets.push_back(static_cast<uint32_t>(schedule->candidates.size()));
+        }
+        return schedule;
+    }
+
+    // One broadcast step for analytic_pending by schedule lookup. Returns false, changing
+    // nothing, when the schedules do not describe this step: attempts are in flight, steps
+    // changed length, or some sender could hit its bandwidth limit (every neighbor with an
+    // attempt due is charged, so the reference would throttle nothing when this passes).
+    bool broadcast_analytic(int ms, double bandwidth_kb_per_ms)
+    {
+        if (!global_pending.empty() || !cohorts.empty())
+            return false;
+        if (ms != analytic_step_ms)
+        {
+            for (const auto &at : analytic_pending)
+                if (at.steps > 0)
+                    return false;
+            analytic_step_ms = ms;
+            seed_schedules.clear();
+        }
+        const double max_transmitted = bandwidth_kb_per_ms * ms;
+        std::vector<double> load(num_peers, 0.0);
+        for (const auto &at : analytic_pending)
+        {
+            const SeedSchedule &s = seed_schedule(at.seed);
+            for (size_t i = at.cursor; i < s.peer.size() && s.step[i] <= at.steps + 1; ++i)
+                for (uint32_t j = s.candidate_offsets[i]; j < s.candidate_offsets[i + 1]; ++j)
+                    if ((load[s.candidates[j]] += at.tx.size_kb) > max_transmitted)
+                        return false;
+        }
+
+        const Topology &topo = *topology;
+        std::vector<std::pair<int, bool>> arrivals;
+        BroadcastStats stats;
+        size_t kept = 0;
+        for (auto &at : analytic_pending)
+        {
+            const SeedSchedule &s = *seed_schedules[at.seed];
+            const int inject_ms = tx_inject_ms[at.tx.id];
+            at.steps++;
+            arrivals.clear();
+            for (; at.cursor < s.peer.size() && s.step[at.cursor] <= at.steps; ++at.cursor)
             {
-                int neighbor = nPair.first;
-                gpt.attempts.push_back(DeliveryAttempt(seed, neighbor));
+                int r = s.peer[at.cursor];
+                known[r].set(at.tx.id);
+                stats.deliveries++;
+                stats.transmitted_kb += at.tx.size_kb;
+                arrivals.emplace_back(inject_ms + s.arrival_ms[at.cursor], topo.isValidator[r]);
+                if (events)
+                    events->deliver(arrivals.back().first, s.sender[at.cursor], r, at.tx.id, s.delay_ms[at.cursor]);
             }
-            global_pending.push_back(gpt);
+            std::sort(arrivals.begin(), arrivals.end());
+            for (const auto &[at_ms, validator] : arrivals)
+                count_arrival(at.tx.id, validator, at_ms);
+            if (at.cursor < s.peer.size())
+                analytic_pending[kept++] = at;
         }
+        analytic_pending.erase(analytic_pending.begin() + kept, analytic_pending.end());
+        network_time_ms += ms;
+        last_broadcast = stats;
+        log_info("Broadcasted for {} ms (analytic).\n", ms);
+        return true;
+    }
+
+    // Hand analytic_pending over to delivery attempts: every peer that knows a tx gets an
+    // attempt to each neighbor that does not, with the timer it would have had.
+    void materialize_analytic()
+    {
+        const Topology &topo = *topology;
+        for (const auto &at : analytic_pending)
+        {
+            const SeedSchedule &s = seed_schedule(at.seed);
+            GlobalPendingTx &gpt = global_pending.emplace_back(at.tx, at.seed);
+            auto open_attempts = [&](int sender, int learned_step)
+            {
+                for (const auto &c : topo.connections[sender])
+                    if (!known[c.peer].test(at.tx.id))
+                        gpt.attempts.emplace_back(sender, c.peer, c.delay_ms).timer = (at.steps - learned_step) * analytic_step_ms;
+            };
+            open_attempts(at.seed, 0);
+            for (size_t i = 0; i < std::min<size_t>(at.cursor, s.peer.size()); ++i)
+                open_attempts(s.peer[i], s.step[i]);
+            if (gpt.attempts.empty())
+                global_pending.pop_back();
+        }
+        analytic_pending.clear();
+        sort_global_pending();
+        attempts_fallback = true;
+        log_info("Analytic propagation no longer applies (bandwidth or step length); using delivery attempts.\n");
+    }
+
+    // One broadcast step for cohorts: the reference loop with one attempt list per cohort,
+    // applied to all of its txs. Returns false, changing nothing, when single-tx attempts are
+    // in flight or some sender could hit its bandwidth limit (every due attempt to a peer
+    // that does not know the cohort yet is charged the cohort's total size).
+    bool broadcast_cohorts(int ms, double bandwidth_kb_per_ms)
+    {
+        if (!global_pending.empty())
+            return false;
+        const double max_transmitted = bandwidth_kb_per_ms * ms;
+        std::vector<double> load(num_peers, 0.0);
+        for (const auto &cohort : cohorts)
+            for (const auto &a : cohort.attempts)
+                if (a.timer + ms >= a.delay_ms && !known[a.receiver].test(cohort.tx_ids[0]) &&
+                    (load[a.sender] += cohort.size_kb) > max_transmitted)
+                    return false;
+
+        const Topology &topo = *topology;
+        const int step_end_ms = network_time_ms + ms;
+        std::vector<std::pair<int, bool>> arrivals;
+        std::vector<DeliveryAttempt> next;
+        BroadcastStats stats;
+        size_t kept = 0;
+        for (size_t i = 0; i < cohorts.size(); ++i)
+        {
+            Cohort &cohort = cohorts[i];
+            const int probe = cohort.tx_ids[0]; // Every tx of the cohort is known by the same peers.
+            const int64_t n = static_cast<int64_t>(cohort.tx_ids.size());
+            next.clear();
+            arrivals.clear();
+            for (auto &attempt : cohort.attempts)
+            {
+                attempt.timer += ms;
+                assert_known_bounds(attempt.receiver, cohort.tx_ids.back());
+                if (known[attempt.receiver].test(probe))
+                    continue;
+                if (attempt.timer < attempt.delay_ms)
+                {
+                    next.push_back(attempt);
+                    continue;
+                }
+                stats.deliveries += n;
+                stats.transmitted_kb += cohort.size_kb;
+                for (int id : cohort.tx_ids)
+                    known[attempt.receiver].set(id);
+                arrivals.emplace_back(step_end_ms - std::min(attempt.timer - attempt.delay_ms, ms), topo.isValidator[attempt.receiver]);
+                if (events)
+                    for (int id : cohort.tx_ids)
+                        events->deliver(arrivals.back().first, attempt.sender, attempt.receiver, id, attempt.delay_ms);
+                for (const auto &c : topo.connections[attempt.receiver])
+                    if (c.peer != attempt.sender && !known[c.peer].test(probe))
+                        next.push_back(DeliveryAttempt(attempt.receiver, c.peer, c.delay_ms));
+            }
+            std::sort(arrivals.begin(), arrivals.end());
+            for (int id : cohort.tx_ids)
+                for (const auto &[at_ms, validator] : arrivals)
+                    count_arrival(id, validator, at_ms);
+            cohort.attempts.swap(next);
+            stats.in_flight_attempts += static_cast<int64_t>(cohort.attempts.size()) * n;
+            if (cohort.attempts.empty())
+                continue;
+            if (kept != i)
+                cohorts[kept] = std::move(cohort);
+            kept++;
+        }
+        cohorts.erase(cohorts.begin() + kept, cohorts.end());
+        network_time_ms = step_end_ms;
+        last_broadcast = stats;
+        log_info("Broadcasted for {} ms ({} cohorts).\n", ms, cohorts.size());
+        return true;
+    }
+
+    // Split every cohort into single txs with their own copy of its attempts.
+    void materialize_cohorts()
+    {
+        for (const auto &cohort : cohorts)
+            for (int id : cohort.tx_ids)
+                global_pending.emplace_back(Transaction(id, tx_size_kb[id]), -1).attempts = cohort.attempts;
+        cohorts.clear();
+        sort_global_pending();
+        attempts_fallback = true;
+        log_info("Cohort propagation no longer applies (bandwidth); using delivery attempts.\n");
+    }
+
+    // Helper: Restore the reference order of global_pending (injection order, i.e. tx id).
+    void sort_global_pending()
+    {
+        std::stable_sort(global_pending.begin(), global_pending.end(), [](const GlobalPendingTx &a, const GlobalPendingTx &b)
+                         { return a.tx.id < b.tx.id; });
+    }
+
+    // One reference broadcast step on the worker pool (see set_threads). Transactions are
+    // sharded over the workers, and each peer's known set is owned by one worker (peers in
+    // contiguous partitions). The step is the synchronisation window: an attempt queued
+    // during a step, by a delivery, is first processed in the next step, whatever its delay.
+    // A step's deliveries therefore depend only on the known sets at its start and on the
+    // same tx's earlier deliveries, so nothing crosses partitions within a step, and
+    // barrier-separated phases reproduce the sequential loop exactly:
+    //   0. senders whose due attempts (to peers that do not know the tx) could exceed their
+    //      budget are hot; every other sender's due attempts deliver. Each worker lists its
+    //      txs' hot attempts, and worker 0 commits the hot senders' budgets over those lists
+    //      in tx order, as the sequential loop does, deciding which deliver and which are
+    //      throttled;
+    //   1. each worker advances its txs' timers and decides deliveries against the known
+    //      sets as of the step start plus the tx's earlier deliveries, posting every
+    //      (receiver, tx) to the receiver's owner;
+    //   2. each owner applies what was posted to it to its peers' known sets;
+    //   3. each worker rebuilds its txs' attempt lists; a peer counts as knowing the tx at
+    //      attempt j if it did at the step start or got it from an attempt before j.
+    // Only the budget pass is sequential, and it only visits hot senders' due attempts. Lazy
+    // mode and event tracing always run sequentially.
+    bool broadcast_parallel(int ms, double bandwidth_kb_per_ms)
+    {
+        if (!parallel || broadcast_mode == BroadcastMode::Lazy || events || global_pending.empty())
+            return false;
+        WorkerPool &pool = parallel->pool;
+        const int workers = pool.size();
+        const size_t n = global_pending.size();
+        const double max_transmitted = bandwidth_kb_per_ms * ms;
+        const Topology &topo = *topology;
+        const int step_end_ms = network_time_ms + ms;
+        auto shard = [&](int w)
+        { return n * w / workers; };
+        auto owner = [&](int peer)
+        { return static_cast<int>(static_cast<int64_t>(peer) * workers / num_peers); };
+
+        // Workers bump coverage counters of different txs concurrently: take exclusive
+        // ownership of every chunk they may touch first, so none of them copies one.
+        size_t last_chunk = SIZE_MAX;
+        for (const auto &gpt : global_pending)
+        {
+            size_t chunk = gpt.tx.id / decltype(tx_known_peers)::CHUNK;
+            if (chunk == last_chunk)
+                continue;
+            tx_known_peers.mut(gpt.tx.id);
+            tx_known_validators.mut(gpt.tx.id);
+            last_chunk = chunk;
+        }
+
+        std::vector<char> &hot_sender = parallel->hot_sender;
+        bool any_hot = false;
+        int64_t throttled = 0;
+        pool.run([&](int w)
+                 {
+            WorkerScratch &ws = parallel->scratch[w];
+            const size_t begin = shard(w), end = shard(w + 1);
+            ws.load.assign(num_peers, 0.0);
+            ws.knew_at_start.clear();
+            for (size_t i = begin; i < end; ++i)
+            {
+                const GlobalPendingTx &gpt = global_pending[i];
+                for (const auto &a : gpt.attempts)
+                {
+                    // Later phases read this instead of known, which phase 2 changes.
+                    bool knew = known[a.receiver].test(gpt.tx.id);
+                    ws.knew_at_start.push_back(knew);
+                    if (a.timer + ms >= a.delay_ms && !knew)
+                        ws.load[a.sender] += gpt.tx.size_kb;
+                }
+            }
+            pool.sync();
+            if (w == 0)
+            {
+                hot_sender.assign(num_peers, 0);
+                for (int u = 0; u < num_peers; ++u)
+                {
+                    double load = 0.0;
+                    for (const auto &other : parallel->scratch)
+                        load += other.load[u];
+                    hot_sender[u] = load > max_transmitted;
+                    any_hot = any_hot || hot_sender[u];
+                }
+            }
+            pool.sync();
+
+            // Phase 0: list hot attempts, then commit hot senders' budgets in tx order.
+            ws.hot.clear();
+            ws.hot_offsets.clear();
+            if (any_hot)
+            {
+                ws.claimed.resize(num_peers, 0);
+                const char *knew_at_start = ws.knew_at_start.data();
+                for (size_t i = begin; i < end; ++i)
+                {
+                    const GlobalPendingTx &gpt = global_pending[i];
+                    ws.hot_offsets.push_back(ws.hot.size());
+                    for (size_t j = 0; j < gpt.attempts.size(); ++j)
+                    {
+                        const DeliveryAttempt &a = gpt.attempts[j];
+                        const bool receiver_knew = *knew_at_start++;
+                        if (receiver_knew || a.timer + ms < a.delay_ms || ws.claimed[a.receiver])
+                            continue;
+                        if (hot_sender[a.sender])
+                        {
+                            ws.hot.push_back({static_cast<int>(j), a.receiver, a.sender, false});
+                            continue;
+                        }
+                        ws.claimed[a.receiver] = 1;
+                        ws.claimed_peers.push_back(a.receiver);
+                    }
+                    for (int r : ws.claimed_peers)
+                        ws.claimed[r] = 0;
+                    ws.claimed_peers.clear();
+                }
+                ws.hot_offsets.push_back(ws.hot.size());
+            }
+            pool.sync();
+            if (w == 0 && any_hot)
+            {
+                parallel->transmitted.assign(num_peers, 0.0);
+                parallel->taken.assign(num_peers, 0);
+                for (int o = 0; o < workers; ++o)
+                {
+                    WorkerScratch &other = parallel->scratch[o];
+                    const size_t other_begin = shard(o);
+                    for (size_t t = 0; t + 1 < other.hot_offsets.size(); ++t)
+                    {
+                        const int size_kb = global_pending[other_begin + t].tx.size_kb;
+                        const size_t first = other.hot_offsets[t], last = other.hot_offsets[t + 1];
+                        for (size_t k = first; k < last; ++k)
+                        {
+                            HotAttempt &h = other.hot[k];
+                            if (parallel->taken[h.receiver])
+                                continue;
+                            if (parallel->transmitted[h.sender] + size_kb > max_transmitted)
+                            {
+                                throttled++;
+                                continue;
+                            }
+                            parallel->transmitted[h.sender] += size_kb;
+                            parallel->taken[h.receiver] = 1;
+                            h.delivers = true;
+                        }
+                        for (size_t k = first; k < last; ++k)
+                            parallel->taken[other.hot[k].receiver] = 0;
+                    }
+                }
+            }
+            pool.sync();
+
+            // Phase 1: decide deliveries, post them to the receivers' owners.
+            ws.delivered_at.resize(num_peers, -1);
+            ws.outbox.resize(workers);
+            for (auto &box : ws.outbox)
+                box.clear();
+            ws.deliveries.clear();
+            ws.delivery_offsets.clear();
+            const char *knew_at_start = ws.knew_at_start.data();
+            for (size_t i = begin; i < end; ++i)
+            {
+                GlobalPendingTx &gpt = global_pending[i];
+                const int id = gpt.tx.id;
+                const size_t first = ws.deliveries.size();
+                ws.delivery_offsets.push_back(first);
+                size_t hot = any_hot ? ws.hot_offsets[i - begin] : 0;
+                for (size_t j = 0; j < gpt.attempts.size(); ++j)
+                {
+                    DeliveryAttempt &attempt = gpt.attempts[j];
+                    attempt.timer += ms;
+                    assert_known_bounds(attempt.receiver, id);
+                    if (*knew_at_start++ || attempt.timer < attempt.delay_ms || ws.delivered_at[attempt.receiver] >= 0)
+                        continue;
+                    if (hot_sender[attempt.sender])
+                    {
+                        // Listed in phase 0 (no earlier attempt delivers to this receiver).
+                        while (ws.hot[hot].attempt < static_cast<int>(j))
+                            ++hot;
+                        if (!ws.hot[hot].delivers)
+                            continue; // Throttled; kept by phase 3.
+                    }
+                    ws.delivered_at[attempt.receiver] = static_cast<int>(j);
+                    ws.deliveries.emplace_back(attempt.receiver, static_cast<int>(j));
+                    ws.outbox[owner(attempt.receiver)].emplace_back(attempt.receiver, id);
+                }
+                for (size_t d = first; d < ws.deliveries.size(); ++d)
+                    ws.delivered_at[ws.deliveries[d].first] = -1;
+            }
+            ws.delivery_offsets.push_back(ws.deliveries.size());
+            pool.sync();
+
+            // Phase 2: apply the deliveries to the peers this worker owns.
+            for (const auto &other : parallel->scratch)
+                for (const auto &[receiver, id] : other.outbox[w])
+                    known[receiver].set(id);
+            pool.sync();
+
+            // Phase 3: rebuild attempt lists in sequential order, count arrivals.
+            ws.stats = BroadcastStats{};
+            for (auto &h : ws.peer_latency)
+                h.clear();
+            for (auto &h : ws.validator_latency)
+                h.clear();
+            knew_at_start = ws.knew_at_start.data();
+            for (size_t i = begin; i < end; ++i)
+            {
+                GlobalPendingTx &gpt = global_pending[i];
+                const int id = gpt.tx.id;
+                const size_t first = ws.delivery_offsets[i - begin], last = ws.delivery_offsets[i - begin + 1];
+                for (size_t d = first; d < last; ++d)
+                    ws.delivered_at[ws.deliveries[d].first] = ws.deliveries[d].second;
+                auto knew = [&](int peer, int j)
+                { return ws.delivered_at[peer] < j && known[peer].test(id); };
+                ws.next_attempts.clear();
+                ws.arrivals.clear();
+                for (size_t j = 0; j < gpt.attempts.size(); ++j)
+                {
+                    const DeliveryAttempt &attempt = gpt.attempts[j];
+                    const bool receiver_knew = *knew_at_start++;
+                    if (ws.delivered_at[attempt.receiver] != static_cast<int>(j))
+                    {
+                        // Known before attempt j: at the step start, or from an earlier attempt.
+                        int at = ws.delivered_at[attempt.receiver];
+                        if (at < 0 ? !receiver_knew : at > static_cast<int>(j))
+                            ws.next_attempts.push_back(attempt);
+                        continue;
+                    }
+                    ws.stats.deliveries++;
+                    ws.stats.transmitted_kb += gpt.tx.size_kb;
+                    ws.arrivals.emplace_back(step_end_ms - std::min(attempt.timer - attempt.delay_ms, ms), topo.isValidator[attempt.receiver]);
+                    for (const auto &c : topo.connections[attempt.receiver])
+                        if (c.peer != attempt.sender && !knew(c.peer, static_cast<int>(j)))
+                            ws.next_attempts.push_back(DeliveryAttempt(attempt.receiver, c.peer, c.delay_ms));
+                }
+                std::sort(ws.arrivals.begin(), ws.arrivals.end());
+                for (const auto &[at_ms, validator] : ws.arrivals)
+                    count_arrival(id, validator, at_ms, ws.peer_latency, ws.validator_latency);
+                gpt.attempts.swap(ws.next_attempts);
+                ws.stats.in_flight_attempts += gpt.attempts.size();
+                for (size_t d = first; d < last; ++d)
+                    ws.delivered_at[ws.deliveries[d].first] = -1;
+            } });
+
+        BroadcastStats stats;
+        stats.throttled_attempts = throttled;
+        for (const auto &ws : parallel->scratch)
+        {
+            stats.deliveries += ws.stats.deliveries;
+            stats.transmitted_kb += ws.stats.transmitted_kb;
+            stats.in_flight_attempts += ws.stats.in_flight_attempts;
+            for (size_t k = 0; k < COVERAGE_FRACTIONS.size(); ++k)
+            {
+                peer_coverage_latency[k].merge(ws.peer_latency[k]);
+                validator_coverage_latency[k].merge(ws.validator_latency[k]);
+            }
+        }
+        std::erase_if(global_pending, [](const GlobalPendingTx &gpt)
+                      { return gpt.attempts.empty(); });
+        network_time_ms = step_end_ms;
+        last_broadcast = stats;
+        parallel_steps++;
+        log_info("Broadcasted for {} ms ({} threads).\n", ms, workers);
+        return true;
     }
 
     void broadcast(int ms, double bandwidth_kb_per_ms)
     {
+        // Items are deliveries on every path (analytic and cohort steps have no attempt lists),
+        // so BROADCAST_ITEMS means the same whatever the mode or thread count.
+        ScopedPhaseTimer timer(profiler, Phase::Broadcast);
+        EventTracer::Span span(events, Phase::Broadcast);
+        if (!analytic_pending.empty())
+        {
+            if (broadcast_analytic(ms, bandwidth_kb_per_ms))
+            {
+                timer.items(last_broadcast.deliveries);
+                return;
+            }
+            materialize_analytic();
+        }
+        if (!cohorts.empty())
+        {
+            if (broadcast_cohorts(ms, bandwidth_kb_per_ms))
+            {
+                timer.items(last_broadcast.deliveries);
+                return;
+            }
+            materialize_cohorts();
+        }
+        if (broadcast_parallel(ms, bandwidth_kb_per_ms))
+        {
+            timer.items(last_broadcast.deliveries);
+            return;
+        }
+        const Topology &topo = *topology;
         double max_transmitted = bandwidth_kb_per_ms * ms;
-        std::unordered_map<int, double> transmitted;
-        for (const auto &p : connections)
-            transmitted[p.first] = 0.0;
+        std::vector<double> transmitted(num_peers, 0.0);
+        const int step_end_ms = network_time_ms + ms;
+        std::vector<std::pair<int, bool>> arrivals; // (time, receiver is validator) for the current tx
+        BroadcastStats stats;
         std::vector<GlobalPendingTx> newGlobal;
+        // Lazy mode: after this step every queued attempt of a tx advances by the same amount,
+        // so delay_ms - timer orders their delivery steps. An attempt is queued only if no
+        // attempt queued before it for the same receiver has a remaining delay <= its own;
+        // that one delivers in an earlier step, or in the same step and first in list order.
+        const bool lazy = broadcast_mode == BroadcastMode::Lazy;
+        std::vector<int> best_remaining(lazy ? num_peers : 0, INT_MAX);
+        std::vector<int> queued_receivers;
+        std::vector<DeliveryAttempt> newAttempts;
+        auto enqueue = [&](const DeliveryAttempt &attempt)
+        {
+            if (lazy)
+            {
+                int remaining = attempt.delay_ms - attempt.timer;
+                int &best = best_remaining[attempt.receiver];
+                if (best <= remaining)
+                {
+                    stats.pruned_attempts++;
+                    return;
+                }
+                if (best == INT_MAX)
+                    queued_receivers.push_back(attempt.receiver);
+                best = remaining;
+            }
+            newAttempts.push_back(attempt);
+        };
         for (auto &gpt : global_pending)
         {
-            std::vector<DeliveryAttempt> newAttempts;
+            newAttempts.clear();
+            arrivals.clear();
             for (auto &attempt : gpt.attempts)
             {
                 attempt.timer += ms;
-                int row, col;
-                get_known_position(gpt.tx.id, row, col);
-                assert_known_bounds(attempt.receiver, row, col);
-                if (known[attempt.receiver][row][col])
+                assert_known_bounds(attempt.receiver, gpt.tx.id);
+                if (known[attempt.receiver].test(gpt.tx.id))
                     continue;
-                if (attempt.timer >= connections[attempt.sender][attempt.receiver].delay_ms)
+                if (attempt.timer >= attempt.delay_ms)
                 {
                     if (transmitted[attempt.sender] + gpt.tx.size_kb > max_transmitted)
                     {
+                        stats.throttled_attempts++;
                         newAttempts.push_back(attempt);
                         continue;
                     }
                     transmitted[attempt.sender] += gpt.tx.size_kb;
-                    get_known_position(gpt.tx.id, row, col);
-                    assert_known_bounds(attempt.receiver, row, col);
-                    known[attempt.receiver][row][col] = true;
-                    for (const auto &nPair : connections[attempt.receiver])
+                    stats.deliveries++;
+                    stats.transmitted_kb += gpt.tx.size_kb;
+                    known[attempt.receiver].set(gpt.tx.id);
+                    // Arrival within this step: when the delay elapsed, or the step start if throttled before.
+                    arrivals.emplace_back(step_end_ms - std::min(attempt.timer - attempt.delay_ms, ms), topo.isValidator[attempt.receiver]);
+                    if (events)
+                        events->deliver(arrivals.back().first, attempt.sender, attempt.receiver, gpt.tx.id, attempt.delay_ms);
+                    for (const auto &c : topo.connections[attempt.receiver])
                     {
-                        int neighbor = nPair.first;
-                        if (neighbor == attempt.sender)
+                        if (c.peer == attempt.sender)
                             continue;
-                        int r, c;
-                        get_known_position(gpt.tx.id, r, c);
-                        assert_known_bounds(neighbor, r, c);
-                        if (!known[neighbor][r][c])
-                            newAttempts.push_back(DeliveryAttempt(attempt.receiver, neighbor));
+                        if (!known[c.peer].test(gpt.tx.id))
+                            enqueue(DeliveryAttempt(attempt.receiver, c.peer, c.delay_ms));
                     }
                 }
                 else
                 {
-                    newAttempts.push_back(attempt);
+                    enqueue(attempt);
                 }
             }
+            for (int r : queued_receivers)
+                best_remaining[r] = INT_MAX;
+            queued_receivers.clear();
+            std::sort(arrivals.begin(), arrivals.end());
+            for (const auto &[at_ms, validator] : arrivals)
+                count_arrival(gpt.tx.id, validator, at_ms);
             gpt.attempts = newAttempts;
+            stats.in_flight_attempts += gpt.attempts.size();
             if (!gpt.attempts.empty())
                 newGlobal.push_back(gpt);
         }
         global_pending = newGlobal;
-        std::print("Broadcasted for {} ms.\n", ms);
+        network_time_ms = step_end_ms;
+        last_broadcast = stats;
+        timer.items(stats.deliveries);
+        if (lazy)
+            log_info("Broadcasted for {} ms ({} redundant attempts pruned).\n", ms, stats.pruned_attempts);
+        else
+            log_info("Broadcasted for {} ms.\n", ms);
     }
 
-    // Prepare request: build candidate transactions from pending_tx_ids using the chosen validator's known matrix.
+    // Prepare request: build candidate transactions from pending_tx_ids AND the chosen validator's known set.
     void prepare_request(int maximum_transaction, int maximum_block_size)
     {
-        std::vector<int> local_validator_ids;
-        for (const auto &p : isValidator)
-            if (p.second)
-                local_validator_ids.push_back(p.first);
+        ScopedPhaseTimer timer(profiler, Phase::PrepareRequest);
+        EventTracer::Span span(events, Phase::PrepareRequest);
+        const std::vector<int> &local_validator_ids = topology->validator_ids;
         if (local_validator_ids.empty())
         {
-            std::print("No validators available for prepare_request.\n");
+            log_info("No validators available for prepare_request.\n");
             return;
         }
         std::uniform_int_distribution<int> dis(0, local_validator_ids.size() - 1);
         int chosen_validator = local_validator_ids[dis(engine)];
         std::vector<Transaction> candidate;
-        for (int tx_id : pending_tx_ids)
-        {
-            Transaction tx = tx_lookup.at(tx_id);
-            int row, col;
-            get_known_position(tx.id, row, col);
-            assert_known_bounds(chosen_validator, row, col);
-            if (known[chosen_validator][row][col])
-                candidate.push_back(tx);
-        }
+        candidate.reserve(KnownSet::and_cardinality(pending_tx_ids, known[chosen_validator]));
+        KnownSet::for_each_and(pending_tx_ids, known[chosen_validator], [&](int tx_id)
+                               { candidate.push_back(Transaction(tx_id, tx_size_kb[tx_id])); });
+        timer.items(candidate.size());
         std::shuffle(candidate.begin(), candidate.end(), engine);
         std::vector<Transaction> selected;
         int current_block_size = 0;
@@ -459,68 +1974,96 @@ public:
         // Calculate proposed_ids from proposed_transactions.
         proposed_ids.clear();
         for (const auto &tx : proposed_transactions)
-            proposed_ids.insert(tx.id);
-        std::print("Prepared request from validator {} with {} transactions (total block size: {} KB).\n",
-                   chosen_validator, proposed_transactions.size(), current_block_size);
+            proposed_ids.set(tx.id);
+        if (events)
+            events->propose(network_time_ms, chosen_validator, static_cast<int>(proposed_transactions.size()));
+        log_info("Prepared request from validator {} with {} transactions (total block size: {} KB).\n",
+                 chosen_validator, proposed_transactions.size(), current_block_size);
     }
 
     void print_publish_request_summary(double threshold) const
     {
         if (proposed_transactions.empty())
         {
-            std::print("No proposed transactions available for summary.\n");
+            log_info("No proposed transactions available for summary.\n");
             return;
         }
         double total_percent = 0.0;
         int count_validators = 0;
-        for (const auto &p : isValidator)
+        std::vector<uint64_t> counts = validator_coverage_counts();
+        for (size_t i = 0; i < topology->validator_ids.size(); ++i)
         {
-            if (p.second)
-            {
-                int peer = p.first;
-                count_validators++;
-                int count = 0;
-                for (const auto &tx : proposed_transactions)
-                {
-                    int row, col;
-                    get_known_position(tx.id, row, col);
-                    assert_known_bounds(peer, row, col);
-                    if (known.at(peer)[row][col])
-                        count++;
-                }
-                double percentage = (proposed_transactions.empty()) ? 0.0 : (count * 100.0 / proposed_transactions.size());
-                std::print("Validator {} has {:.2f}% of proposed transactions.\n", peer, percentage);
-                total_percent += percentage;
-            }
+            int peer = topology->validator_ids[i];
+            count_validators++;
+            uint64_t count = counts[i];
+            double percentage = (proposed_transactions.empty()) ? 0.0 : (count * 100.0 / proposed_transactions.size());
+            log_info("Validator {} has {:.2f}% of proposed transactions.\n", peer, percentage);
+            total_percent += percentage;
         }
         if (count_validators > 0)
         {
             double avg_percent = total_percent / count_validators;
-            std::print("Average across validators: {:.2f}%\n", avg_percent);
+            log_info("Average across validators: {:.2f}%\n", avg_percent);
+        }
+    }
+
+    // Latency histogram for reaching COVERAGE_FRACTIONS[level] of all peers / validators.
+    const LogHistogram &get_peer_coverage_latency(size_t level) const
+    {
+        return peer_coverage_latency.at(level);
+    }
+
+    const LogHistogram &get_validator_coverage_latency(size_t level) const
+    {
+        return validator_coverage_latency.at(level);
+    }
+
+    // Inclusion latency (ms) of every published transaction.
+    const QuantileSketch &get_inclusion_latency() const
+    {
+        return inclusion_latency;
+    }
+
+    void print_propagation_latency() const
+    {
+        std::print("Propagation latency (ms):      txs       p50       p90       p99       max\n");
+        for (size_t k = 0; k < COVERAGE_FRACTIONS.size(); ++k)
+        {
+            for (int validators = 0; validators < 2; ++validators)
+            {
+                const LogHistogram &h = validators ? validator_coverage_latency[k] : peer_coverage_latency[k];
+                std::print("  {:>3.0f}% of {:<10} {:>10} {:>9} {:>9} {:>9} {:>9}\n", COVERAGE_FRACTIONS[k] * 100,
+                           validators ? "validators" : "peers", h.count(), h.quantile(0.50), h.quantile(0.90),
+                           h.quantile(0.99), h.max());
+            }
         }
     }
 
+    static void print_phase_profile(const std::array<PhaseStats, PHASE_COUNT> &phases)
+    {
+#ifdef MONTECARLO_PROFILE
+        std::print("Phase profile:                 calls        items      wall s\n");
+        for (size_t p = 0; p < PHASE_COUNT; ++p)
+            std::print("  {:<18} {:>14} {:>12} {:>11.4f}\n", PHASE_NAMES[p], phases[p].calls, phases[p].items, phases[p].seconds);
+#else
+        (void)phases;
+#endif
+    }
+
     int publish_proposed_transactions(double threshold, int blocktime, int &simulated_time, int simulation_step_ms, int &forced_publish_count, bool debug = true)
     {
+        ScopedPhaseTimer timer(profiler, Phase::Publish);
+        EventTracer::Span span(events, Phase::Publish);
         if (debug)
             print_publish_request_summary(threshold);
         if (proposed_transactions.empty())
         {
-            std::print("No proposed transactions to publish.\n");
+            log_info("No proposed transactions to publish.\n");
             return 0;
         }
         int count_validators_meeting = 0;
-        for (int v : validator_ids)
+        for (uint64_t count : validator_coverage_counts())
         {
-            int count = 0;
-            for (const auto &tx : proposed_transactions)
-            {
-                int row, col;
-                get_known_position(tx.id, row, col);
-                assert_known_bounds(v, row, col);
-                if (known.at(v)[row][col])
-                    count++;
-            }
             double percentage = (proposed_transactions.empty()) ? 0.0 : (count * 100.0 / proposed_transactions.size());
             if (percentage >= threshold)
                 count_validators_meeting++;
@@ -529,39 +2072,67 @@ public:
         if (count_validators_meeting < M)
         {
             publish_attempt_counter += simulation_step_ms;
-            std::print("Publishing not allowed: only {} validators have >= {:.2f}% (required: {}).\n",
-                       count_validators_meeting, threshold, M);
+            log_info("Publishing not allowed: only {} validators have >= {:.2f}% (required: {}).\n",
+                     count_validators_meeting, threshold, M);
             if (publish_attempt_counter >= blocktime)
             {
-                std::print("Forced publishing triggered ({} ms reached).\n", publish_attempt_counter);
+                log_info("Forced publishing triggered ({} ms reached).\n", publish_attempt_counter);
                 forced_publish_count++;
                 simulated_time += 2 * blocktime;
+                forced_delay_ms += 2 * blocktime;
+                forced_delay_marks.emplace_back(network_time_ms, forced_delay_ms);
                 published_count = proposed_transactions.size();
+                timer.items(published_count);
+                if (events)
+                    events->publish(network_time_ms, published_count, true, 2 * blocktime);
                 updateAndCleanAfterPublishedCompleted(debug, threshold);
                 return published_count;
             }
             return 0;
         }
+        timer.items(published_count);
+        if (events)
+            events->publish(network_time_ms, published_count, false, 0);
         updateAndCleanAfterPublishedCompleted(debug, threshold);
         return published_count;
     }
 
     // run_experiment returns an ExperimentResult and prints progress including MB stats.
-    struct ExperimentResult run_experiment(int total_simulation_ms, int injection_count, int simulation_step_ms, double publish_threshold, int blocktime, double bandwidth_kb_per_ms, int max_transactions, int max_block_size)
+    // Injects injection_count transactions per step, seeded uniformly over non-validators.
+    // With reset_state = false the run continues from the current state (e.g. a restored
+    // snapshot) instead of an empty network; results cover this run only.
+    struct ExperimentResult run_experiment(int total_simulation_ms, int injection_count, int simulation_step_ms, double publish_threshold, int blocktime, double bandwidth_kb_per_ms, int max_transactions, int max_block_size, bool reset_state = true)
     {
-        std::print("Experiment is beginning...\n");
-        clean_network_txs();
+        ComposedWorkload workload(std::make_unique<FixedArrivals>(injection_count), std::make_unique<UniformSeeds>());
+        return run_experiment(workload, total_simulation_ms, simulation_step_ms, publish_threshold, blocktime,
+                              bandwidth_kb_per_ms, max_transactions, max_block_size, reset_state);
+    }
+
+    // run_experiment with arrivals and seed peers drawn from a Workload.
+    struct ExperimentResult run_experiment(Workload &workload, int total_simulation_ms, int simulation_step_ms, double publish_threshold, int blocktime, double bandwidth_kb_per_ms, int max_transactions, int max_block_size, bool reset_state = true)
+    {
+        log_info("Experiment is beginning...\n");
+        if (reset_state)
+            clean_network_txs();
+        else
+            reset_measurements();
+        profiler.reset();
+        run_digest.clear();
+        steady_state.reset(0, total_published_global, total_published_size_kb, get_pending_count());
+        attempts_fallback = false;
+        parallel_steps = 0;
         int simulated_time = 0;
         int official_sim_time = 0;
         int block_cycle_time = 0;
         int forced_publish_count = 0;
-        while (simulated_time < total_simulation_ms)
+        bool stopped_on_convergence = false;
+        while (simulated_time < total_simulation_ms && !stopped_on_convergence)
         {
-            std::print("Pending transactions before injection: {}\n", get_pending_count());
+            log_info("Pending transactions before injection: {}\n", get_pending_count());
             while (block_cycle_time < (blocktime + publish_attempt_counter) && simulated_time < total_simulation_ms)
             {
                 int step = std::min(simulation_step_ms, (blocktime + publish_attempt_counter) - block_cycle_time);
-                inject_transactions(injection_count);
+                inject_workload(workload, simulated_time, step);
                 broadcast(step, bandwidth_kb_per_ms);
                 block_cycle_time += step;
                 simulated_time += step;
@@ -569,31 +2140,51 @@ public:
                 double sim_sec = simulated_time / 1000.0;
                 double published_MB_progress = total_published_size_kb / 1024.0;
                 double MB_per_sec_progress = (sim_sec > 0) ? published_MB_progress / sim_sec : 0;
-                std::print("Progress: {:.2f} sec simulated, published {} txs, TPS: {} txs/sec, pending {} txs, Published MB: {:.2f}, MB/sec: {:.2f}, forced publish count: {}\n\n",
-                           sim_sec, total_published_global,
-                           (sim_sec > 0 ? static_cast<int>(std::round(total_published_global / sim_sec)) : 0),
-                           get_pending_count(), published_MB_progress, MB_per_sec_progress, forced_publish_count);
+                log_info("Progress: {:.2f} sec simulated, published {} txs, TPS: {} txs/sec, pending {} txs, Published MB: {:.2f}, MB/sec: {:.2f}, forced publish count: {}\n\n",
+                         sim_sec, total_published_global,
+                         (sim_sec > 0 ? static_cast<int>(std::round(total_published_global / sim_sec)) : 0),
+                         get_pending_count(), published_MB_progress, MB_per_sec_progress, forced_publish_count);
+                if (metrics)
+                    metrics->record(current_step_metrics(simulated_time));
+                if (digest_mode)
+                {
+                    run_digest.add(get_pending_count());
+                    run_digest.add(total_published_global);
+                }
             }
             if (proposed_transactions.empty())
             {
                 prepare_request(max_transactions, max_block_size);
             }
-            int published_now = publish_proposed_transactions(publish_threshold, blocktime, simulated_time, simulation_step_ms, forced_publish_count, true);
+            int published_now = publish_proposed_transactions(publish_threshold, blocktime, simulated_time, simulation_step_ms, forced_publish_count, verbose);
             if (published_now > 0)
             {
                 block_cycle_time = 0;
+                steady_state.add_block(simulated_time, total_published_global, total_published_size_kb, get_pending_count());
+                stopped_on_convergence = steady_state.get_config().stop_on_convergence && steady_state.converged();
             }
         }
         double total_seconds = simulated_time / 1000.0;
         double tps = (total_seconds > 0) ? total_published_global / total_seconds : 0;
         double published_MB = total_published_size_kb / 1024.0;
         double MB_per_sec = (total_seconds > 0) ? published_MB / total_seconds : 0;
-        std::print("\n--- Experiment Complete ---\n");
-        std::print("Total simulated time: {} ms ({} sec)\n", simulated_time, total_seconds);
-        std::print("Total published transactions: {}\n", total_published_global);
-        std::print("Transactions per second (TPS): {:.2f}\n", tps);
-        std::print("Total Published MB: {:.2f}\n", published_MB);
-        std::print("MB per Second: {:.2f}\n", MB_per_sec);
+        log_info("\n--- Experiment Complete ---\n");
+        log_info("Total simulated time: {} ms ({} sec)\n", simulated_time, total_seconds);
+        log_info("Total published transactions: {}\n", total_published_global);
+        log_info("Transactions per second (TPS): {:.2f}\n", tps);
+        log_info("Total Published MB: {:.2f}\n", published_MB);
+        log_info("MB per Second: {:.2f}\n", MB_per_sec);
+        if (steady_state.steady())
+            log_info("Steady state after {} ms warm-up: {:.2f} TPS, {:.2f} MB/sec over {} blocks{}\n",
+                     steady_state.warmup_ms(), steady_state.steady_tps(), steady_state.steady_MB_per_sec(),
+                     steady_state.steady_blocks(), stopped_on_convergence ? " (converged, stopped early)" : "");
+        else
+            log_info("Steady state not reached.\n");
+        if (verbose)
+            print_propagation_latency();
+        log_info("Inclusion latency (ms): p50 {:.0f}, p90 {:.0f}, p99 {:.0f}, max {:.0f} over {} txs\n",
+                 inclusion_latency.quantile(0.50), inclusion_latency.quantile(0.90),
+                 inclusion_latency.quantile(0.99), inclusion_latency.max(), inclusion_latency.count());
 
         ExperimentResult result;
         result.total_simulated_time = simulated_time;
@@ -603,8 +2194,193 @@ public:
         result.MB_per_sec = MB_per_sec;
         result.forced_publish_count = forced_publish_count;
         result.final_pending_count = get_pending_count();
+        for (size_t k = 0; k < COVERAGE_FRACTIONS.size(); ++k)
+        {
+            result.peer_coverage_ms[k] = LatencySummary::from(peer_coverage_latency[k]);
+            result.validator_coverage_ms[k] = LatencySummary::from(validator_coverage_latency[k]);
+        }
+        result.inclusion_ms = LatencySummary::from(inclusion_latency);
+        result.phases = profiler.report();
+        result.steady_state = steady_state.steady();
+        result.warmup_ms = steady_state.warmup_ms();
+        result.steady_blocks = steady_state.steady_blocks();
+        result.steady_tps = steady_state.steady_tps();
+        result.steady_MB_per_sec = steady_state.steady_MB_per_sec();
+        result.stopped_on_convergence = stopped_on_convergence;
+        result.parallel_steps = parallel_steps;
+        if (digest_mode)
+        {
+            run_digest.add(get_pending_count());
+            run_digest.add(total_published_global);
+            digest_known_sets(run_digest);
+            result.digest = run_digest.value();
+        }
+        if (verbose)
+            print_phase_profile(result.phases);
+        return result;
+    }
+
+    // run_fluid_experiment: Flow-level approximation of run_experiment (see fluid.hpp) on this
+    // topology, validator set and tx size range. Its cost does not grow with injection_count,
+    // so it suits capacity estimates at extreme TPS. The network's own state is not touched;
+    // digest and phase profile are not produced.
+    ExperimentResult run_fluid_experiment(int total_simulation_ms, int injection_count, int simulation_step_ms, double publish_threshold, int blocktime, double bandwidth_kb_per_ms, int max_transactions, int max_block_size, const FluidConfig &config = {}) const
+    {
+        FluidModel model(topology->connections, topology->validator_ids, topology->seed_peers, config);
+        FluidParams params{total_simulation_ms, injection_count, simulation_step_ms, publish_threshold, blocktime,
+                           bandwidth_kb_per_ms, max_transactions, max_block_size, tx_size_min, tx_size_max, M, rng_seed};
+        FluidModel::FluidResult fluid = model.run(params, {COVERAGE_FRACTIONS.begin(), COVERAGE_FRACTIONS.end()},
+                                                  steady_state.get_config());
+
+        ExperimentResult result;
+        double total_seconds = fluid.total_simulated_time / 1000.0;
+        result.total_simulated_time = fluid.total_simulated_time;
+        result.total_published_global = static_cast<int>(std::llround(fluid.published));
+        result.tps = total_seconds > 0 ? fluid.published / total_seconds : 0;
+        result.published_MB = fluid.published_kb / 1024.0;
+        result.MB_per_sec = total_seconds > 0 ? result.published_MB / total_seconds : 0;
+        result.forced_publish_count = fluid.forced_publish_count;
+        result.final_pending_count = static_cast<int>(std::llround(fluid.pending));
+        for (size_t k = 0; k < COVERAGE_FRACTIONS.size(); ++k)
+        {
+            result.peer_coverage_ms[k] = LatencySummary::from(fluid.peer_coverage[k]);
+            result.validator_coverage_ms[k] = LatencySummary::from(fluid.validator_coverage[k]);
+        }
+        result.inclusion_ms = LatencySummary::from(fluid.inclusion);
+        result.steady_state = fluid.steady_state.steady();
+        result.warmup_ms = fluid.steady_state.warmup_ms();
+        result.steady_blocks = fluid.steady_state.steady_blocks();
+        result.steady_tps = fluid.steady_state.steady_tps();
+        result.steady_MB_per_sec = fluid.steady_state.steady_MB_per_sec();
+        result.stopped_on_convergence = fluid.stopped_on_convergence;
+        log_info("Fluid experiment: {} ms simulated, {:.2f} TPS, {:.2f} MB/sec, {} forced publishes, {} pending.\n",
+                 result.total_simulated_time, result.tps, result.MB_per_sec, result.forced_publish_count,
+                 result.final_pending_count);
         return result;
     }
+
+    // FluidCalibration: The exact and fluid engines on the same experiment.
+    struct FluidCalibration
+    {
+        ExperimentResult exact;
+        ExperimentResult fluid;
+        double tps_error;     // Relative, fluid vs exact.
+        double pending_error; // Final pending, relative to the txs injected.
+    };
+
+    // calibrate_fluid: Run the experiment with the exact engine (on a fresh fork, so this
+    // network is not changed) and with the fluid model; verbose prints both side by side. Meant
+    // for small cases, to check the approximation before trusting it at scale.
+    FluidCalibration calibrate_fluid(int total_simulation_ms, int injection_count, int simulation_step_ms, double publish_threshold, int blocktime, double bandwidth_kb_per_ms, int max_transactions, int max_block_size, const FluidConfig &config = {}) const
+    {
+        Network exact_network = fork();
+        exact_network.set_verbose(false);
+        FluidCalibration c;
+        c.exact = exact_network.run_experiment(total_simulation_ms, injection_count, simulation_step_ms, publish_threshold,
+                                               blocktime, bandwidth_kb_per_ms, max_transactions, max_block_size);
+        c.fluid = run_fluid_experiment(total_simulation_ms, injection_count, simulation_step_ms, publish_threshold,
+                                       blocktime, bandwidth_kb_per_ms, max_transactions, max_block_size, config);
+        c.tps_error = c.exact.tps > 0 ? (c.fluid.tps - c.exact.tps) / c.exact.tps : 0.0;
+        double injected = static_cast<double>(injection_count) * (total_simulation_ms / simulation_step_ms);
+        c.pending_error = injected > 0 ? (c.fluid.final_pending_count - c.exact.final_pending_count) / injected : 0.0;
+
+        log_info("Fluid calibration:                 exact        fluid\n");
+        log_info("  TPS                      {:>12.2f} {:>12.2f}  ({:+.1f}%)\n", c.exact.tps, c.fluid.tps, c.tps_error * 100);
+        log_info("  MB/sec                   {:>12.2f} {:>12.2f}\n", c.exact.MB_per_sec, c.fluid.MB_per_sec);
+        log_info("  Published txs            {:>12} {:>12}\n", c.exact.total_published_global, c.fluid.total_published_global);
+        log_info("  Final pending txs        {:>12} {:>12}  ({:+.1f}% of injected)\n", c.exact.final_pending_count,
+                 c.fluid.final_pending_count, c.pending_error * 100);
+        log_info("  Forced publishes         {:>12} {:>12}\n", c.exact.forced_publish_count, c.fluid.forced_publish_count);
+        for (size_t k = 0; k < COVERAGE_FRACTIONS.size(); ++k)
+            log_info("  {:>3.0f}% of peers p50 (ms)   {:>12} {:>12}\n", COVERAGE_FRACTIONS[k] * 100,
+                     c.exact.peer_coverage_ms[k].p50, c.fluid.peer_coverage_ms[k].p50);
+        log_info("  Inclusion p50 (ms)       {:>12} {:>12}\n", c.exact.inclusion_ms.p50, c.fluid.inclusion_ms.p50);
+        return c;
+    }
+
+    // PropagationResult: What run_sharded_propagation measured.
+    struct PropagationResult
+    {
+        int total_simulated_time = 0; // in ms
+        int injected = 0;
+        int64_t deliveries = 0;
+        int64_t throttled_attempts = 0;
+        double transmitted_MB = 0.0;
+        std::array<LatencySummary, COVERAGE_FRACTIONS.size()> peer_coverage_ms;
+        std::array<LatencySummary, COVERAGE_FRACTIONS.size()> validator_coverage_ms;
+        // Per peer: known-set digest, comparable with known_digest(peer) of a run that
+        // injected the same txs and published none.
+        std::vector<uint64_t> known_digest;
+    };
+
+    // run_sharded_propagation: Inject and propagate txs as run_experiment does, split over
+    // config.shards processes (see sharded.hpp); no blocks are produced. The network's own state
+    // is not touched. Returns false if the shards could not be started or one of them failed.
+    bool run_sharded_propagation(int total_simulation_ms, int injection_count, int simulation_step_ms, double bandwidth_kb_per_ms, const ShardConfig &config, PropagationResult &result) const
+    {
+        ShardedPropagation sharded(topology->connections, config);
+        if (!sharded.start(simulation_step_ms, bandwidth_kb_per_ms, injection_count))
+            return false;
+        ComposedWorkload workload(std::make_unique<FixedArrivals>(injection_count), std::make_unique<UniformSeeds>());
+        InjectionBatch batch;
+        std::vector<int> inject_ms;
+        std::vector<uint32_t> known_peers, known_validators;
+        CoverageHistograms peer_latency, validator_latency;
+        // As count_arrival, on this run's own counters.
+        auto arrive = [&](int tx_id, int peer, int at_ms)
+        {
+            uint32_t peers = ++known_peers[tx_id];
+            uint32_t validators = topology->isValidator[peer] ? ++known_validators[tx_id] : 0;
+            int latency = at_ms - inject_ms[tx_id];
+            for (size_t k = 0; k < COVERAGE_FRACTIONS.size(); ++k)
+            {
+                if (peers == peer_coverage_target[k])
+                    peer_latency[k].record(latency);
+                if (validators == validator_coverage_target[k])
+                    validator_latency[k].record(latency);
+            }
+        };
+
+        int next_id = 0;
+        int simulated_time = 0;
+        while (simulated_time < total_simulation_ms)
+        {
+            int step = std::min(simulation_step_ms, total_simulation_ms - simulated_time);
+            WorkloadContext ctx{rng_seed, next_id, num_peers, tx_size_min, tx_size_max, topology->seed_peers};
+            workload.generate(ctx, simulated_time, step, batch);
+            int n = static_cast<int>(batch.size());
+            inject_ms.insert(inject_ms.end(), n, simulated_time);
+            known_peers.insert(known_peers.end(), n, 0);
+            known_validators.insert(known_validators.end(), n, 0);
+            for (int i = 0; i < n; ++i)
+                arrive(next_id + i, batch.seed[i], simulated_time);
+            if (!sharded.step(simulated_time, next_id, batch, [&](int tx_id, int at_ms, int peer)
+                              { arrive(tx_id, peer, at_ms); }))
+                return false;
+            next_id += n;
+            simulated_time += step;
+        }
+        ShardedPropagation::Result totals;
+        if (!sharded.finish(totals))
+            return false;
+
+        result = PropagationResult{};
+        result.total_simulated_time = simulated_time;
+        result.injected = next_id;
+        result.deliveries = totals.deliveries;
+        result.throttled_attempts = totals.throttled_attempts;
+        result.transmitted_MB = totals.transmitted_kb / 1024.0;
+        for (size_t k = 0; k < COVERAGE_FRACTIONS.size(); ++k)
+        {
+            result.peer_coverage_ms[k] = LatencySummary::from(peer_latency[k]);
+            result.validator_coverage_ms[k] = LatencySummary::from(validator_latency[k]);
+        }
+        result.known_digest = std::move(totals.known_digest);
+        log_info("Sharded propagation: {} ms simulated over {} shards, {} txs injected, {} deliveries, {} throttled attempts, {:.2f} MB transmitted.\n",
+                 result.total_simulated_time, config.shards, result.injected, result.deliveries,
+                 result.throttled_attempts, result.transmitted_MB);
+        return true;
+    }
 };
 
 #endif // NETWORK_HPP
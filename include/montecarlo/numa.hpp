@@ -0,0 +1,96 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/*
+=======================================================================
+  NUMA TOPOLOGY AND CPU PINNING
+=======================================================================
+
+Reads the CPUs of each NUMA node from sysfs
+(/sys/devices/system/node/node<N>/cpulist, e.g. "0-15,32-47") and pins
+the calling process to a CPU list. A process pinned before it allocates
+gets its memory on the local node (first touch), which is what the
+sharded mode relies on. Machines without sysfs NUMA information report
+no nodes; pinning is a no-op off Linux.
+*/
+
+// parse_cpu_list: "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}.
+inline std::vector<int> parse_cpu_list(const std::string &text)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(text);
+    std::string range;
+    while (std::getline(ss, range, ','))
+    {
+        if (range.empty() || range == "\n")
+            continue;
+        size_t dash = range.find('-');
+        try
+        {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        catch (const std::exception &)
+        {
+            return {};
+        }
+    }
+    return cpus;
+}
+
+// numa_node_cpus: CPUs of every NUMA node that has any, in node order.
+inline std::vector<std::vector<int>> numa_node_cpus(const std::string &root = "/sys/devices/system/node")
+{
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(root, ec))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+            !std::all_of(name.begin() + 4, name.end(), [](char c)
+                         { return c >= '0' && c <= '9'; }))
+            continue;
+        std::ifstream in(entry.path() / "cpulist");
+        std::string text;
+        if (!std::getline(in, text))
+            continue;
+        std::vector<int> cpus = parse_cpu_list(text);
+        if (!cpus.empty())
+            nodes.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+    }
+    std::sort(nodes.begin(), nodes.end());
+    std::vector<std::vector<int>> result;
+    for (auto &node : nodes)
+        result.push_back(std::move(node.second));
+    return result;
+}
+
+// pin_to_cpus: Restrict the calling process to cpus. Returns false if that failed.
+inline bool pin_to_cpus(const std::vector<int> &cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+#endif // NUMA_HPP
@@ -0,0 +1,147 @@
+#ifndef PHILOX_HPP
+#define PHILOX_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/*
+=======================================================================
+  COUNTER-BASED RANDOM NUMBERS
+=======================================================================
+
+Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2,
+3") maps a 128-bit counter and a 64-bit key to four 32-bit random words
+with no hidden state. A value depends only on (seed, purpose, a, b, index),
+so any thread can regenerate exactly the numbers another thread would
+have drawn and FIXED_SEED runs stay bit-identical however work is split.
+
+Callers key streams by what the numbers are for (RngPurpose) and by the
+entity they belong to (e.g. tx id and step), never by thread.
+*/
+
+// RngPurpose: Separates independent streams drawn from the same seed.
+enum class RngPurpose : uint32_t
+{
+    TxSize = 1,
+    SeedPeer = 2,
+    Workload = 3,
+    Broadcast = 4,
+    Proposal = 5,
+    Experiment = 6
+};
+
+struct Philox4x32
+{
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    static constexpr uint32_t M0 = 0xD2511F53;
+    static constexpr uint32_t M1 = 0xCD9E8D57;
+    static constexpr uint32_t W0 = 0x9E3779B9;
+    static constexpr uint32_t W1 = 0xBB67AE85;
+
+    static constexpr Counter generate(Counter ctr, Key key)
+    {
+        for (int round = 0; round < 10; ++round)
+        {
+            uint64_t p0 = static_cast<uint64_t>(M0) * ctr[0];
+            uint64_t p1 = static_cast<uint64_t>(M1) * ctr[2];
+            ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0], static_cast<uint32_t>(p1),
+                   static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1], static_cast<uint32_t>(p0)};
+            key[0] += W0;
+            key[1] += W1;
+        }
+        return ctr;
+    }
+};
+
+// Random123 known-answer test for Philox4x32-10.
+static_assert(Philox4x32::generate({0, 0, 0, 0}, {0, 0})[0] == 0x6627e8d5);
+
+// counter_random: Stateless draw number `index` of stream (seed, purpose, a, b).
+// Four consecutive indices share one Philox block.
+inline uint32_t counter_random(uint64_t seed, RngPurpose purpose, uint32_t a, uint32_t b, uint32_t index)
+{
+    Philox4x32::Counter ctr{index >> 2, a, b, static_cast<uint32_t>(purpose)};
+    Philox4x32::Key key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+    return Philox4x32::generate(ctr, key)[index & 3];
+}
+
+// counter_uniform_int: Map one 32-bit draw to [lo, hi] (multiply-shift, no rejection).
+inline int counter_uniform_int(uint32_t r, int lo, int hi)
+{
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(hi) - lo + 1);
+    return lo + static_cast<int>((static_cast<uint64_t>(r) * range) >> 32);
+}
+
+// counter_unit: Map one 32-bit draw to [0, 1).
+inline double counter_unit(uint32_t r)
+{
+    return r * (1.0 / 4294967296.0);
+}
+
+// counter_fill: out[i] = draw (first_index + i) of stream (seed, purpose, a = 0, b = 0) for
+// i < n, one Philox block per four draws. No loop-carried state, so it vectorizes and any
+// split of the index range yields the same values.
+template <typename F>
+inline void counter_fill(uint64_t seed, RngPurpose purpose, uint32_t first_index, int n, F &&out)
+{
+    const Philox4x32::Key key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+    int i = 0;
+    while (i < n)
+    {
+        uint32_t index = first_index + static_cast<uint32_t>(i);
+        auto block = Philox4x32::generate({index >> 2, 0, 0, static_cast<uint32_t>(purpose)}, key);
+        for (uint32_t k = index & 3; k < 4 && i < n; ++k, ++i)
+            out(i, block[k]);
+    }
+}
+
+// CounterRng: UniformRandomBitGenerator over one (seed, purpose, a, b) stream,
+// usable with std distributions. Cheap to construct; copy it to fork a stream.
+class CounterRng
+{
+public:
+    using result_type = uint32_t;
+
+    CounterRng(uint64_t seed, RngPurpose purpose, uint32_t a, uint32_t b = 0)
+        : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+          ctr{0, a, b, static_cast<uint32_t>(purpose)}
+    {
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint32_t>::max(); }
+
+    result_type operator()()
+    {
+        if (used == 4)
+        {
+            block = Philox4x32::generate(ctr, key);
+            ctr[0]++;
+            used = 0;
+        }
+        return block[used++];
+    }
+
+    void discard(unsigned long long n)
+    {
+        while (n > 0 && used < 4)
+        {
+            used++;
+            n--;
+        }
+        ctr[0] += static_cast<uint32_t>(n / 4);
+        for (n %= 4; n > 0; --n)
+            (*this)();
+    }
+
+private:
+    Philox4x32::Key key;
+    Philox4x32::Counter ctr;
+    Philox4x32::Counter block{};
+    int used = 4;
+};
+
+#endif // PHILOX_HPP
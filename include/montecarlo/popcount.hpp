@@ -0,0 +1,210 @@
+#ifndef POPCOUNT_HPP
+#define POPCOUNT_HPP
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define MONTECARLO_X86_KERNELS 1
+#endif
+
+/*
+=======================================================================
+  POPCOUNT KERNELS
+=======================================================================
+
+Masked popcount kernels used for block coverage: given one bitmap (the
+proposed ids) and several others (the validators' known bitmaps), count
+|a AND b_j| for every j while streaming a only once.
+
+Three implementations are provided and picked once at runtime from CPUID:
+  - Portable: std::popcount over 64-bit words;
+  - AVX2:     nibble-lookup popcount (vpshufb + vpsadbw), 256 bits/iter;
+  - AVX512:   native vpopcntq (AVX512-VPOPCNTDQ), 512 bits/iter.
+*/
+
+enum class PopcountKernel
+{
+    Auto,
+    Portable,
+    AVX2,
+    AVX512
+};
+
+// Signature shared by all kernels: out[j] += |a AND bs[j]| over n words, for j < count.
+using PopcountAndManyFn = void (*)(const uint64_t *a, const uint64_t *const *bs, size_t count, size_t n, uint64_t *out);
+
+namespace popcount_detail
+{
+    inline void and_many_portable(const uint64_t *a, const uint64_t *const *bs, size_t count, size_t n, uint64_t *out)
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            const uint64_t *b = bs[j];
+            uint64_t total = 0;
+            for (size_t i = 0; i < n; ++i)
+                total += std::popcount(a[i] & b[i]);
+            out[j] += total;
+        }
+    }
+
+#ifdef MONTECARLO_X86_KERNELS
+    // Validators processed per pass; keeps one accumulator register per validator.
+    constexpr size_t GROUP = 8;
+
+    __attribute__((target("avx2"))) inline __m256i popcount256(__m256i v)
+    {
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_mask = _mm256_set1_epi8(0x0f);
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+        return _mm256_sad_epu8(cnt, _mm256_setzero_si256()); // four 64-bit partial sums
+    }
+
+    __attribute__((target("avx2"))) inline void and_many_avx2(const uint64_t *a, const uint64_t *const *bs, size_t count, size_t n, uint64_t *out)
+    {
+        size_t vec_n = n & ~size_t(3);
+        for (size_t g = 0; g < count; g += GROUP)
+        {
+            size_t k = (count - g < GROUP) ? count - g : GROUP;
+            __m256i acc[GROUP];
+            for (size_t j = 0; j < k; ++j)
+                acc[j] = _mm256_setzero_si256();
+            for (size_t i = 0; i < vec_n; i += 4)
+            {
+                __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+                for (size_t j = 0; j < k; ++j)
+                {
+                    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bs[g + j] + i));
+                    acc[j] = _mm256_add_epi64(acc[j], popcount256(_mm256_and_si256(va, vb)));
+                }
+            }
+            for (size_t j = 0; j < k; ++j)
+            {
+                alignas(32) uint64_t lanes[4];
+                _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc[j]);
+                uint64_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+                for (size_t i = vec_n; i < n; ++i)
+                    total += std::popcount(a[i] & bs[g + j][i]);
+                out[g + j] += total;
+            }
+        }
+    }
+
+    __attribute__((target("avx512f,avx512vpopcntdq"))) inline void and_many_avx512(const uint64_t *a, const uint64_t *const *bs, size_t count, size_t n, uint64_t *out)
+    {
+        size_t vec_n = n & ~size_t(7);
+        for (size_t g = 0; g < count; g += GROUP)
+        {
+            size_t k = (count - g < GROUP) ? count - g : GROUP;
+            __m512i acc[GROUP];
+            for (size_t j = 0; j < k; ++j)
+                acc[j] = _mm512_setzero_si512();
+            for (size_t i = 0; i < vec_n; i += 8)
+            {
+                __m512i va = _mm512_loadu_si512(a + i);
+                for (size_t j = 0; j < k; ++j)
+                {
+                    __m512i vb = _mm512_loadu_si512(bs[g + j] + i);
+                    acc[j] = _mm512_add_epi64(acc[j], _mm512_popcnt_epi64(_mm512_and_si512(va, vb)));
+                }
+            }
+            for (size_t j = 0; j < k; ++j)
+            {
+                alignas(64) uint64_t lanes[8];
+                _mm512_store_si512(lanes, acc[j]);
+                uint64_t total = 0;
+                for (uint64_t lane : lanes)
+                    total += lane;
+                for (size_t i = vec_n; i < n; ++i)
+                    total += std::popcount(a[i] & bs[g + j][i]);
+                out[g + j] += total;
+            }
+        }
+    }
+#endif
+
+    inline PopcountKernel detect()
+    {
+#ifdef MONTECARLO_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq"))
+            return PopcountKernel::AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return PopcountKernel::AVX2;
+#endif
+        return PopcountKernel::Portable;
+    }
+
+    inline PopcountAndManyFn resolve(PopcountKernel kernel)
+    {
+#ifdef MONTECARLO_X86_KERNELS
+        if (kernel == PopcountKernel::AVX512)
+            return and_many_avx512;
+        if (kernel == PopcountKernel::AVX2)
+            return and_many_avx2;
+#endif
+        return and_many_portable;
+    }
+
+    struct State
+    {
+        PopcountKernel kernel;
+        PopcountAndManyFn fn;
+    };
+
+    inline State &state()
+    {
+        static State s{detect(), resolve(detect())};
+        return s;
+    }
+}
+
+// select_popcount_kernel: Force a kernel (e.g. Portable for reference runs); Auto restores CPUID detection.
+// Requests for a kernel the CPU does not support fall back to the best supported one.
+inline void select_popcount_kernel(PopcountKernel kernel)
+{
+    PopcountKernel best = popcount_detail::detect();
+    if (kernel == PopcountKernel::Auto || static_cast<int>(kernel) > static_cast<int>(best))
+        kernel = best;
+    popcount_detail::state() = {kernel, popcount_detail::resolve(kernel)};
+}
+
+inline PopcountKernel active_popcount_kernel()
+{
+    return popcount_detail::state().kernel;
+}
+
+inline const char *popcount_kernel_name(PopcountKernel kernel)
+{
+    switch (kernel)
+    {
+    case PopcountKernel::Portable:
+        return "portable";
+    case PopcountKernel::AVX2:
+        return "avx2";
+    case PopcountKernel::AVX512:
+        return "avx512";
+    default:
+        return "auto";
+    }
+}
+
+// popcount_and_many: out[j] += |a AND bs[j]| over n words, using the active kernel.
+inline void popcount_and_many(const uint64_t *a, const uint64_t *const *bs, size_t count, size_t n, uint64_t *out)
+{
+    popcount_detail::state().fn(a, bs, count, n, out);
+}
+
+// popcount_and: Number of bits set in (a[i] & b[i]) over n words.
+inline size_t popcount_and(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    uint64_t out = 0;
+    popcount_and_many(a, &b, 1, n, &out);
+    return out;
+}
+
+#endif // POPCOUNT_HPP
@@ -0,0 +1,123 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+=======================================================================
+  PHASE PROFILER
+=======================================================================
+
+Per-phase wall time, call counts and items processed for the simulation
+hot paths (inject, broadcast, prepare_request, publish). Timing reads the
+TSC (rdtsc) where available and a steady clock otherwise; ticks are
+converted to seconds from the TSC/steady-clock ratio observed between
+reset() and the report, so no calibration loop is needed.
+
+Build with MONTECARLO_PROFILE defined to enable it (the CMake option of
+the same name, on by default). Without it ScopedPhaseTimer is an empty
+type and all instrumentation compiles away; reports are then zero.
+*/
+
+enum class Phase
+{
+    Inject,
+    Broadcast,
+    PrepareRequest,
+    Publish
+};
+
+constexpr size_t PHASE_COUNT = 4;
+constexpr std::array<const char *, PHASE_COUNT> PHASE_NAMES{"INJECT", "BROADCAST", "PREPARE_REQUEST", "PUBLISH"};
+
+// PhaseStats: Totals for one phase.
+struct PhaseStats
+{
+    uint64_t calls = 0;
+    uint64_t items = 0;  // Phase-specific work units (txs injected, deliveries, ...).
+    uint64_t ticks = 0;  // Raw timer ticks.
+    double seconds = 0.0;
+};
+
+inline uint64_t profiler_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+class PhaseProfiler
+{
+public:
+    PhaseProfiler() { reset(); }
+
+    void reset()
+    {
+        stats = {};
+        start_ticks = profiler_ticks();
+        start_time = std::chrono::steady_clock::now();
+    }
+
+    void add(Phase phase, uint64_t ticks, uint64_t items)
+    {
+        PhaseStats &s = stats[static_cast<size_t>(phase)];
+        s.calls++;
+        s.items += items;
+        s.ticks += ticks;
+    }
+
+    // Totals with seconds filled in.
+    std::array<PhaseStats, PHASE_COUNT> report() const
+    {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        uint64_t elapsed_ticks = profiler_ticks() - start_ticks;
+        double seconds_per_tick = elapsed_ticks ? elapsed / elapsed_ticks : 0.0;
+        auto out = stats;
+        for (auto &s : out)
+            s.seconds = s.ticks * seconds_per_tick;
+        return out;
+    }
+
+private:
+    std::array<PhaseStats, PHASE_COUNT> stats;
+    uint64_t start_ticks = 0;
+    std::chrono::steady_clock::time_point start_time;
+};
+
+#ifdef MONTECARLO_PROFILE
+// ScopedPhaseTimer: Charges the enclosing scope's time to phase.
+class ScopedPhaseTimer
+{
+public:
+    ScopedPhaseTimer(PhaseProfiler &profiler, Phase phase)
+        : profiler(profiler), phase(phase), start(profiler_ticks()) {}
+    ~ScopedPhaseTimer() { profiler.add(phase, profiler_ticks() - start, item_count); }
+    ScopedPhaseTimer(const ScopedPhaseTimer &) = delete;
+    ScopedPhaseTimer &operator=(const ScopedPhaseTimer &) = delete;
+
+    void items(uint64_t n) { item_count += n; }
+
+private:
+    PhaseProfiler &profiler;
+    Phase phase;
+    uint64_t start;
+    uint64_t item_count = 0;
+};
+#else
+class ScopedPhaseTimer
+{
+public:
+    ScopedPhaseTimer(PhaseProfiler &, Phase) {}
+    void items(uint64_t) {}
+};
+#endif
+
+#endif // PROFILER_HPP
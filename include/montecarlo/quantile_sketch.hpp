@@ -0,0 +1,138 @@
+#ifndef QUANTILE_SKETCH_HPP
+#define QUANTILE_SKETCH_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+/*
+=======================================================================
+  QUANTILE SKETCH
+=======================================================================
+
+DDSketch (Masson et al., VLDB 2019): streaming quantiles with a relative
+error guarantee. A positive value v goes to bucket ceil(log_gamma(v)),
+gamma = (1 + alpha) / (1 - alpha), and any quantile is answered within
+alpha relative error. Buckets are a dense window over the indices seen;
+when it would exceed max_buckets the lowest buckets are collapsed into
+one, so memory is bounded and only the smallest values lose accuracy.
+*/
+
+class QuantileSketch
+{
+public:
+    explicit QuantileSketch(double relative_accuracy = 0.01, size_t max_buckets = 2048)
+        : gamma((1.0 + relative_accuracy) / (1.0 - relative_accuracy)),
+          log_gamma(std::log(gamma)),
+          max_buckets(max_buckets)
+    {
+    }
+
+    void add(double value, uint64_t n = 1)
+    {
+        total += n;
+        max_value = std::max(max_value, value);
+        if (value <= 0.0)
+        {
+            zero_count += n;
+            return;
+        }
+        int index = static_cast<int>(std::ceil(std::log(value) / log_gamma));
+        if (bins.empty())
+        {
+            offset = index;
+            bins.assign(1, 0);
+        }
+        if (index < offset)
+        {
+            // Grow downwards unless that exceeds the budget; then fold into the lowest bin.
+            int grow = offset - index;
+            if (bins.size() + grow > max_buckets)
+                index = offset;
+            else
+            {
+                bins.insert(bins.begin(), grow, 0);
+                offset = index;
+            }
+        }
+        if (index >= offset + static_cast<int>(bins.size()))
+        {
+            bins.resize(index - offset + 1, 0);
+            collapse();
+            index = std::max(index, offset);
+        }
+        bins[index - offset] += n;
+    }
+
+    void merge(const QuantileSketch &other)
+    {
+        for (size_t i = 0; i < other.bins.size(); ++i)
+            if (other.bins[i])
+                add(other.bin_value(other.offset + static_cast<int>(i)), other.bins[i]);
+        zero_count += other.zero_count;
+        total += other.zero_count;
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    void clear()
+    {
+        bins.clear();
+        offset = 0;
+        zero_count = 0;
+        total = 0;
+        max_value = 0.0;
+    }
+
+    uint64_t count() const { return total; }
+    double max() const { return max_value; }
+
+    // Value at quantile q in [0, 1], within the relative accuracy.
+    double quantile(double q) const
+    {
+        if (total == 0)
+            return 0.0;
+        uint64_t rank = static_cast<uint64_t>(q * (total - 1));
+        if (rank < zero_count)
+            return 0.0;
+        uint64_t seen = zero_count;
+        for (size_t i = 0; i < bins.size(); ++i)
+        {
+            seen += bins[i];
+            if (seen > rank)
+                return std::min(bin_value(offset + static_cast<int>(i)), max_value);
+        }
+        return max_value;
+    }
+
+private:
+    // Representative value of bucket i: midpoint (in relative terms) of (gamma^(i-1), gamma^i].
+    double bin_value(int index) const
+    {
+        return 2.0 * std::pow(gamma, index) / (gamma + 1.0);
+    }
+
+    void collapse()
+    {
+        if (bins.size() <= max_buckets)
+            return;
+        size_t excess = bins.size() - max_buckets;
+        uint64_t folded = 0;
+        for (size_t i = 0; i <= excess; ++i)
+            folded += bins[i];
+        bins.erase(bins.begin(), bins.begin() + excess);
+        bins[0] = folded;
+        offset += static_cast<int>(excess);
+    }
+
+    double gamma;
+    double log_gamma;
+    size_t max_buckets;
+    std::vector<uint64_t> bins;
+    int offset = 0;
+    uint64_t zero_count = 0;
+    uint64_t total = 0;
+    double max_value = 0.0;
+};
+
+#endif // QUANTILE_SKETCH_HPP
@@ -0,0 +1,759 @@
+#ifndef SHARDED_HPP
+#define SHARDED_HPP
+
+#include <print>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include <montecarlo/known_set.hpp>
+#include <montecarlo/digest.hpp>
+#include <montecarlo/workload.hpp>
+#include <montecarlo/shm_ring.hpp>
+#include <montecarlo/numa.hpp>
+
+/*
+=======================================================================
+  MULTI-PROCESS SHARDED PROPAGATION
+=======================================================================
+
+Propagation split over shard processes, so each one's known sets live
+in memory local to the NUMA node it runs on. Peers are cut into
+contiguous partitions, one per shard. A shard owns its peers' known
+sets and every delivery attempt addressed to one of them. Shards are
+forked from the coordinator, the process that called start(), after it
+mapped one shared anonymous region. Each shard pins itself to the CPUs
+of NUMA node (shard % nodes) before allocating anything.
+
+One step:
+  - the coordinator writes the step's injection batch into the shared
+    region and bumps the generation counter;
+  - every shard reads the batch. The owner of the seed marks it known.
+    The owner of each of the seed's neighbours opens that neighbour's
+    attempt;
+  - each shard posts, per sender, the KB its due attempts would take
+    from that sender (see Bandwidth) and waits for the other shards';
+  - each shard advances its attempts the way Network::broadcast does
+    and applies the deliveries. A receiver learns the tx from its
+    earliest-arriving due attempt. The receiver's new attempts go to
+    the neighbours' owners, locally or through that pair's ring;
+  - shards end their outbound rings with an end marker and drain their
+    inbound rings until every other shard's marker has arrived. While an
+    outbound ring is full a shard keeps draining its inbound ones, so
+    there is no cycle of full rings;
+  - each shard reports the step's arrivals to the coordinator through
+    its report ring. The coordinator learns that the step is complete
+    once every shard's end marker is in.
+
+An attempt only delivers in a step after the one that opened it, so a
+step is the lookahead window. Within one, shards wait on each other
+only for the demand posting and the exchange at its end.
+
+Exactness. Without throttling, the set of peers that learn a tx in a
+step does not depend on the order in which attempts are processed, so
+the known sets equal the single-process engine's. Coverage latencies
+use the earliest arrival, not the first attempt in list order.
+
+Bandwidth. A sender has one budget per step, shared by all shards.
+Before advancing, each shard writes its demand on every sender to the
+shared region: the sizes of the due txs for which that sender is a
+receiver's earliest-arriving attempt. Once all shards have posted, each
+one sums a sender's demand D over the shards and gives itself
+  - its own demand d plus an equal share of the slack B - D, if D <= B,
+  - B * d / D otherwise,
+so the shards' budgets for a sender add up to B. When no sender's load
+exceeds its budget nothing is throttled and the run stays exact. For a
+sender that binds, the single-process engine spends the whole budget in
+tx order, while here each shard spends its share in tx order, so which
+txs get through differs. Receivers also try due attempts earliest
+first, not in list order. Totals stay close. On the test topology at
+0.5 KB/ms, deliveries are within 3% of run_experiment's and throttled
+attempts within 5%, for 1 to 3 shards. tests/sharded_test.cpp checks
+these bounds.
+
+Blocks are not produced here. Block production needs every validator's
+known set and stays in the single-process engine.
+*/
+
+// ShardConfig: Processes and ring sizes of a sharded run.
+struct ShardConfig
+{
+    int shards = 2;              // Shard processes (peer partitions).
+    size_t ring_slots = 1 << 16; // Records per ring; a power of two.
+    bool pin_numa = true;        // Pin shard i to the CPUs of NUMA node i % nodes.
+};
+
+class ShardedPropagation
+{
+public:
+    // Result: Totals over all shards after finish().
+    struct Result
+    {
+        int64_t deliveries = 0;
+        int64_t throttled_attempts = 0;
+        double transmitted_kb = 0.0;
+        // Per peer: RunDigest of the known set's cardinality followed by its ids, ascending.
+        std::vector<uint64_t> known_digest;
+    };
+
+    // connections[p]: p's neighbours as {peer, delay_ms} (Connection).
+    template <typename Conn>
+    ShardedPropagation(const std::vector<std::vector<Conn>> &connections, const ShardConfig &config)
+        : num_peers(static_cast<int>(connections.size())), shards(std::max(config.shards, 1)), config(config)
+    {
+        links.resize(connections.size());
+        for (size_t u = 0; u < connections.size(); ++u)
+            for (const auto &conn : connections[u])
+                links[u].push_back({conn.peer, conn.delay_ms});
+    }
+
+    ShardedPropagation(const ShardedPropagation &) = delete;
+    ShardedPropagation &operator=(const ShardedPropagation &) = delete;
+
+    ~ShardedPropagation()
+    {
+        stop();
+    }
+
+    // Map the shared region and fork the shards. Returns false if either failed.
+    bool start(int step_ms, double bandwidth_kb_per_ms, int max_batch)
+    {
+        stop();
+        if (config.ring_slots == 0 || (config.ring_slots & (config.ring_slots - 1)) != 0)
+        {
+            std::print("Error: shard ring size {} is not a power of two.\n", config.ring_slots);
+            return false;
+        }
+        capacity = std::max(max_batch, 1);
+        layout();
+        region = mmap(nullptr, region_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED)
+        {
+            region = nullptr;
+            std::print("Error mapping {} bytes of shared memory for {} shards.\n", region_bytes, shards);
+            return false;
+        }
+        Control *c = new (at(control_offset)) Control{};
+        c->step_ms = step_ms;
+        c->bandwidth_kb_per_ms = bandwidth_kb_per_ms;
+        for (int from = 0; from < shards; ++from)
+        {
+            for (int to = 0; to < shards; ++to)
+                ShmRing<Attempt>::create(at(attempt_ring_offset(from, to)), config.ring_slots);
+            ShmRing<Arrival>::create(at(report_ring_offset(from)), config.ring_slots);
+        }
+
+        std::vector<std::vector<int>> nodes = config.pin_numa ? numa_node_cpus() : std::vector<std::vector<int>>{};
+        generation = 0;
+        for (int shard = 0; shard < shards; ++shard)
+        {
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                std::print("Error: could not start shard process {}.\n", shard);
+                stop();
+                return false;
+            }
+            if (pid == 0)
+            {
+#ifdef __linux__
+                prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+                // Unpinned, the shard still runs correctly, only without node-local memory.
+                if (!nodes.empty() && !pin_to_cpus(nodes[shard % nodes.size()]))
+                    std::print("Warning: shard {} could not be pinned to NUMA node {}: {}.\n", shard,
+                               shard % nodes.size(), std::strerror(errno));
+                shard_main(shard);
+                _exit(0);
+            }
+            pids.push_back(pid);
+        }
+        reports.clear();
+        for (int shard = 0; shard < shards; ++shard)
+            reports.emplace_back(at(report_ring_offset(shard)));
+        return true;
+    }
+
+    // Run one step starting at start_ms, injecting batch as ids first_id, first_id + 1, ...
+    // Calls on_arrival(tx_id, at_ms, peer) for every delivery of the step, ordered by tx and
+    // time. Returns false if a shard process died.
+    template <typename F>
+    bool step(int start_ms, int first_id, const InjectionBatch &batch, F &&on_arrival)
+    {
+        if (static_cast<int>(batch.size()) > capacity)
+        {
+            std::print("Error: injection batch of {} exceeds the shard batch capacity {}.\n", batch.size(), capacity);
+            return false;
+        }
+        Control *c = control();
+        std::copy(batch.size_kb.begin(), batch.size_kb.end(), static_cast<int *>(at(sizes_offset)));
+        std::copy(batch.seed.begin(), batch.seed.end(), static_cast<int *>(at(seeds_offset)));
+        c->start_ms = start_ms;
+        c->first_id = first_id;
+        c->batch_size = static_cast<int>(batch.size());
+        c->generation.store(++generation, std::memory_order_release);
+
+        arrivals.clear();
+        std::vector<bool> ended(shards, false);
+        int remaining = shards;
+        uint64_t idle = 0;
+        while (remaining > 0)
+        {
+            bool progress = false;
+            for (int shard = 0; shard < shards; ++shard)
+            {
+                Arrival a;
+                while (!ended[shard] && reports[shard].try_pop(a))
+                {
+                    progress = true;
+                    if (a.tx < 0)
+                    {
+                        ended[shard] = true;
+                        --remaining;
+                        break;
+                    }
+                    arrivals.push_back(a);
+                }
+            }
+            if (progress)
+                continue;
+            if (++idle % 4096 == 0 && !shards_alive())
+                return false;
+            std::this_thread::yield();
+        }
+        std::sort(arrivals.begin(), arrivals.end(), [](const Arrival &a, const Arrival &b)
+                  { return a.tx != b.tx ? a.tx < b.tx : a.at_ms != b.at_ms ? a.at_ms < b.at_ms : a.peer < b.peer; });
+        for (const Arrival &a : arrivals)
+            on_arrival(a.tx, a.at_ms, a.peer);
+        return true;
+    }
+
+    // Stop the shards and collect their totals and known-set digests.
+    bool finish(Result &result)
+    {
+        if (pids.empty())
+            return false;
+        Control *c = control();
+        c->stop = 1;
+        c->generation.store(++generation, std::memory_order_release);
+        bool ok = true;
+        for (size_t shard = 0; shard < pids.size(); ++shard)
+        {
+            int status = 0;
+            if (waitpid(pids[shard], &status, 0) != pids[shard] || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                std::print("Error: shard process {} failed.\n", shard);
+                ok = false;
+            }
+        }
+        pids.clear();
+        if (ok)
+        {
+            result = Result{};
+            const Totals *totals = static_cast<const Totals *>(at(totals_offset));
+            for (int shard = 0; shard < shards; ++shard)
+            {
+                result.deliveries += totals[shard].deliveries;
+                result.throttled_attempts += totals[shard].throttled_attempts;
+                result.transmitted_kb += totals[shard].transmitted_kb;
+            }
+            const uint64_t *digests = static_cast<const uint64_t *>(at(digests_offset));
+            result.known_digest.assign(digests, digests + num_peers);
+        }
+        stop();
+        return ok;
+    }
+
+private:
+    struct Link
+    {
+        int peer;
+        int delay_ms;
+    };
+
+    // Cross-shard message: open an attempt sender -> receiver for tx (tx < 0: end of step).
+    struct Attempt
+    {
+        int32_t tx;
+        int32_t sender;
+        int32_t receiver;
+        int32_t delay_ms;
+    };
+
+    // Report to the coordinator: peer learned tx at at_ms (tx < 0: end of step).
+    struct Arrival
+    {
+        int32_t tx;
+        int32_t at_ms;
+        int32_t peer;
+    };
+
+    struct Control
+    {
+        alignas(64) std::atomic<uint64_t> generation{0}; // Bumped to start a step.
+        alignas(64) std::atomic<uint64_t> demands_posted{0}; // Shards that posted their demand, all steps.
+        alignas(64) int stop = 0;                        // Set with the last bump.
+        int start_ms = 0;
+        int first_id = 0;
+        int batch_size = 0;
+        int step_ms = 0;
+        double bandwidth_kb_per_ms = 0.0;
+    };
+
+    struct Totals
+    {
+        int64_t deliveries;
+        int64_t throttled_attempts;
+        double transmitted_kb;
+    };
+
+    static size_t align(size_t bytes)
+    {
+        return (bytes + 63) & ~size_t{63};
+    }
+
+    void layout()
+    {
+        size_t offset = 0;
+        auto take = [&](size_t bytes)
+        {
+            size_t start = offset;
+            offset += align(bytes);
+            return start;
+        };
+        control_offset = take(sizeof(Control));
+        sizes_offset = take(sizeof(int) * capacity);
+        seeds_offset = take(sizeof(int) * capacity);
+        digests_offset = take(sizeof(uint64_t) * num_peers);
+        totals_offset = take(sizeof(Totals) * shards);
+        demand_offset = take(sizeof(double) * num_peers * shards);
+        attempt_ring_bytes = align(ShmRing<Attempt>::bytes(config.ring_slots));
+        report_ring_bytes = align(ShmRing<Arrival>::bytes(config.ring_slots));
+        rings_offset = take(attempt_ring_bytes * shards * shards + report_ring_bytes * shards);
+        region_bytes = offset;
+    }
+
+    void *at(size_t offset) const
+    {
+        return static_cast<char *>(region) + offset;
+    }
+
+    Control *control() const
+    {
+        return static_cast<Control *>(at(control_offset));
+    }
+
+    size_t attempt_ring_offset(int from, int to) const
+    {
+        return rings_offset + attempt_ring_bytes * (static_cast<size_t>(from) * shards + to);
+    }
+
+    size_t report_ring_offset(int shard) const
+    {
+        return rings_offset + attempt_ring_bytes * shards * shards + report_ring_bytes * shard;
+    }
+
+    int owner(int peer) const
+    {
+        return static_cast<int>(static_cast<int64_t>(peer) * shards / num_peers);
+    }
+
+    // False (after printing which) if a shard process has exited.
+    bool shards_alive()
+    {
+        for (size_t shard = 0; shard < pids.size(); ++shard)
+        {
+            int status = 0;
+            if (waitpid(pids[shard], &status, WNOHANG) == pids[shard])
+            {
+                std::print("Error: shard process {} exited during the run.\n", shard);
+                pids.erase(pids.begin() + shard);
+                stop();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Kill any running shards and unmap the shared region.
+    void stop()
+    {
+        for (pid_t pid : pids)
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+        pids.clear();
+        reports.clear();
+        if (region)
+            munmap(region, region_bytes);
+        region = nullptr;
+    }
+
+    //////////////////////////
+    // Shard process
+    //////////////////////////
+
+    struct LocalAttempt
+    {
+        int sender;
+        int receiver;
+        int timer;
+        int delay_ms;
+    };
+
+    struct ShardTx
+    {
+        int id;
+        std::vector<LocalAttempt> attempts;
+    };
+
+    struct Shard
+    {
+        int index = 0;
+        int first_peer = 0; // Owned peers: [first_peer, end_peer).
+        int end_peer = 0;
+        std::vector<KnownSet> known; // Owned peers only.
+        std::vector<int> tx_size;    // By tx id.
+        std::vector<ShardTx> pending; // By tx id.
+        std::vector<double> budget;  // Per sender: KB it may still send this step.
+        std::vector<int> earliest;   // Per owned receiver: index of its earliest due attempt, or -1.
+        uint64_t steps = 0;
+        std::vector<ShmRing<Attempt>> out, in;
+        ShmRing<Arrival> report;
+        std::vector<std::vector<Attempt>> outbox; // Per destination shard.
+        std::vector<Attempt> inbox;
+        std::vector<bool> ended;
+        int remaining = 0;
+        std::vector<Arrival> arrivals;
+        std::vector<LocalAttempt> due, kept;
+        Totals totals{0, 0, 0.0};
+
+        bool owns(int peer) const { return peer >= first_peer && peer < end_peer; }
+        KnownSet &known_by(int peer) { return known[peer - first_peer]; }
+    };
+
+    void shard_main(int index)
+    {
+        Shard s;
+        s.index = index;
+        s.first_peer = num_peers;
+        for (int p = 0; p < num_peers; ++p)
+        {
+            if (owner(p) != index)
+                continue;
+            s.first_peer = std::min(s.first_peer, p);
+            s.end_peer = p + 1;
+        }
+        s.end_peer = std::max(s.end_peer, s.first_peer);
+        s.known.resize(s.end_peer - s.first_peer);
+        s.budget.assign(num_peers, 0.0);
+        s.earliest.assign(s.end_peer - s.first_peer, -1);
+        for (int other = 0; other < shards; ++other)
+        {
+            s.out.emplace_back(at(attempt_ring_offset(index, other)));
+            s.in.emplace_back(at(attempt_ring_offset(other, index)));
+        }
+        s.report = ShmRing<Arrival>(at(report_ring_offset(index)));
+        s.outbox.resize(shards);
+
+        Control *c = control();
+        uint64_t seen = 0;
+        for (;;)
+        {
+            uint64_t g;
+            while ((g = c->generation.load(std::memory_order_acquire)) == seen)
+                std::this_thread::yield();
+            seen = g;
+            if (c->stop)
+                break;
+            shard_step(s, *c);
+        }
+
+        uint64_t *digests = static_cast<uint64_t *>(at(digests_offset));
+        for (int p = s.first_peer; p < s.end_peer; ++p)
+        {
+            RunDigest d;
+            d.add(s.known_by(p).cardinality());
+            s.known_by(p).for_each([&](int tx_id)
+                                   { d.add(static_cast<uint64_t>(tx_id)); });
+            digests[p] = d.value();
+        }
+        static_cast<Totals *>(at(totals_offset))[index] = s.totals;
+    }
+
+    void shard_step(Shard &s, Control &c)
+    {
+        const int step_ms = c.step_ms;
+        const int step_end_ms = c.start_ms + step_ms;
+
+        // Injection: the seed's owner marks it, each neighbour's owner opens its attempt.
+        const int *sizes = static_cast<const int *>(at(sizes_offset));
+        const int *seeds = static_cast<const int *>(at(seeds_offset));
+        for (int i = 0; i < c.batch_size; ++i)
+        {
+            const int id = c.first_id + i;
+            const int seed = seeds[i];
+            if (s.tx_size.size() <= static_cast<size_t>(id))
+                s.tx_size.resize(id + 1, 0);
+            s.tx_size[id] = sizes[i];
+            if (s.owns(seed))
+                s.known_by(seed).set(id);
+            ShardTx *tx = nullptr;
+            for (const auto &link : links[seed])
+            {
+                if (!s.owns(link.peer))
+                    continue;
+                if (!tx)
+                    tx = &s.pending.emplace_back(ShardTx{id, {}});
+                tx->attempts.push_back({seed, link.peer, 0, link.delay_ms});
+            }
+        }
+
+        share_budgets(s, c);
+        s.arrivals.clear();
+        for (auto &tx : s.pending)
+            advance(s, tx, step_ms, step_end_ms);
+        exchange(s);
+        merge_inbox(s);
+
+        for (const Arrival &a : s.arrivals)
+            while (!s.report.try_push(a))
+                std::this_thread::yield();
+        while (!s.report.try_push(Arrival{-1, 0, 0}))
+            std::this_thread::yield();
+    }
+
+    // Post this step's demand per sender, wait for every shard's, and set this shard's budgets
+    // (see Bandwidth above). Demand counts each receiver's earliest-arriving due attempt.
+    void share_budgets(Shard &s, Control &c)
+    {
+        double *demand = static_cast<double *>(at(demand_offset));
+        double *own = demand + static_cast<size_t>(s.index) * num_peers;
+        std::fill(own, own + num_peers, 0.0);
+        for (const auto &tx : s.pending)
+        {
+            const int size = s.tx_size[tx.id];
+            for (size_t i = 0; i < tx.attempts.size(); ++i)
+            {
+                const LocalAttempt &a = tx.attempts[i];
+                if (a.timer + c.step_ms < a.delay_ms || s.known_by(a.receiver).test(tx.id))
+                    continue;
+                int &best = s.earliest[a.receiver - s.first_peer];
+                if (best < 0 || earlier(a, tx.attempts[best]))
+                    best = static_cast<int>(i);
+            }
+            for (const auto &a : tx.attempts)
+            {
+                int &best = s.earliest[a.receiver - s.first_peer];
+                if (best < 0)
+                    continue;
+                own[tx.attempts[best].sender] += size;
+                best = -1;
+            }
+        }
+
+        const uint64_t posted = static_cast<uint64_t>(shards) * ++s.steps;
+        c.demands_posted.fetch_add(1, std::memory_order_acq_rel);
+        while (c.demands_posted.load(std::memory_order_acquire) < posted)
+            std::this_thread::yield();
+
+        const double max_transmitted = c.bandwidth_kb_per_ms * c.step_ms;
+        for (int u = 0; u < num_peers; ++u)
+        {
+            double total = 0.0;
+            for (int shard = 0; shard < shards; ++shard)
+                total += demand[static_cast<size_t>(shard) * num_peers + u];
+            s.budget[u] = total <= max_transmitted ? own[u] + (max_transmitted - total) / shards
+                                                   : max_transmitted * own[u] / total;
+        }
+    }
+
+    // True if a arrives before b (ties: lower sender), the order in which due attempts are tried.
+    static bool earlier(const LocalAttempt &a, const LocalAttempt &b)
+    {
+        if (a.timer - a.delay_ms != b.timer - b.delay_ms)
+            return a.timer - a.delay_ms > b.timer - b.delay_ms;
+        return a.sender < b.sender;
+    }
+
+    // One step of tx's attempts, as Network::broadcast but per receiver: the earliest
+    // arriving due attempt whose sender has budget left delivers.
+    void advance(Shard &s, ShardTx &tx, int step_ms, int step_end_ms)
+    {
+        const int id = tx.id;
+        const int size = s.tx_size[id];
+        s.due.clear();
+        s.kept.clear();
+        for (auto &a : tx.attempts)
+        {
+            a.timer += step_ms;
+            if (s.known_by(a.receiver).test(id))
+                continue;
+            if (a.timer < a.delay_ms)
+                s.kept.push_back(a);
+            else
+                s.due.push_back(a);
+        }
+        std::sort(s.due.begin(), s.due.end(), [](const LocalAttempt &a, const LocalAttempt &b)
+                  { return a.receiver != b.receiver ? a.receiver < b.receiver : earlier(a, b); });
+        for (size_t first = 0; first < s.due.size();)
+        {
+            const int receiver = s.due[first].receiver;
+            size_t last = first;
+            while (last < s.due.size() && s.due[last].receiver == receiver)
+                ++last;
+            // Attempts tried before the winner count as throttled, as in Network::broadcast.
+            const LocalAttempt *winner = nullptr;
+            for (size_t i = first; i < last && !winner; ++i)
+            {
+                if (size > s.budget[s.due[i].sender])
+                {
+                    s.totals.throttled_attempts++;
+                    continue;
+                }
+                winner = &s.due[i];
+                s.budget[winner->sender] -= size;
+            }
+            if (!winner)
+            {
+                s.kept.insert(s.kept.end(), s.due.begin() + first, s.due.begin() + last);
+                first = last;
+                continue;
+            }
+            s.known_by(receiver).set(id);
+            s.totals.deliveries++;
+            s.totals.transmitted_kb += size;
+            s.arrivals.push_back({id, step_end_ms - std::min(winner->timer - winner->delay_ms, step_ms), receiver});
+            for (const auto &link : links[receiver])
+            {
+                if (link.peer == winner->sender)
+                    continue;
+                if (!s.owns(link.peer))
+                    s.outbox[owner(link.peer)].push_back({id, receiver, link.peer, link.delay_ms});
+                else if (!s.known_by(link.peer).test(id))
+                    s.kept.push_back({receiver, link.peer, 0, link.delay_ms});
+            }
+            first = last;
+        }
+        tx.attempts.swap(s.kept);
+    }
+
+    // Take whatever the other shards have posted so far.
+    void drain(Shard &s)
+    {
+        for (int other = 0; other < shards; ++other)
+        {
+            Attempt a;
+            while (other != s.index && !s.ended[other] && s.in[other].try_pop(a))
+            {
+                if (a.tx < 0)
+                {
+                    s.ended[other] = true;
+                    --s.remaining;
+                    break;
+                }
+                s.inbox.push_back(a);
+            }
+        }
+    }
+
+    void post(Shard &s, int to, const Attempt &a)
+    {
+        while (!s.out[to].try_push(a))
+        {
+            drain(s);
+            std::this_thread::yield();
+        }
+    }
+
+    // Send the step's cross-shard attempts and receive everyone else's.
+    void exchange(Shard &s)
+    {
+        s.inbox.clear();
+        s.ended.assign(shards, false);
+        s.remaining = shards - 1;
+        for (int to = 0; to < shards; ++to)
+        {
+            if (to == s.index)
+                continue;
+            for (const Attempt &a : s.outbox[to])
+                post(s, to, a);
+            s.outbox[to].clear();
+            post(s, to, Attempt{-1, 0, 0, 0});
+        }
+        while (s.remaining > 0)
+        {
+            drain(s);
+            if (s.remaining > 0)
+                std::this_thread::yield();
+        }
+    }
+
+    // Add received attempts to their txs (keeping pending in id order); drop finished txs.
+    void merge_inbox(Shard &s)
+    {
+        std::stable_sort(s.inbox.begin(), s.inbox.end(), [](const Attempt &a, const Attempt &b)
+                         { return a.tx < b.tx; });
+        std::vector<ShardTx> merged;
+        merged.reserve(s.pending.size());
+        size_t i = 0;
+        auto take_inbox = [&](ShardTx &tx)
+        {
+            for (; i < s.inbox.size() && s.inbox[i].tx == tx.id; ++i)
+                if (!s.known_by(s.inbox[i].receiver).test(tx.id))
+                    tx.attempts.push_back({s.inbox[i].sender, s.inbox[i].receiver, 0, s.inbox[i].delay_ms});
+        };
+        for (auto &tx : s.pending)
+        {
+            while (i < s.inbox.size() && s.inbox[i].tx < tx.id)
+            {
+                ShardTx created{s.inbox[i].tx, {}};
+                take_inbox(created);
+                if (!created.attempts.empty())
+                    merged.push_back(std::move(created));
+            }
+            take_inbox(tx);
+            if (!tx.attempts.empty())
+                merged.push_back(std::move(tx));
+        }
+        while (i < s.inbox.size())
+        {
+            ShardTx created{s.inbox[i].tx, {}};
+            take_inbox(created);
+            if (!created.attempts.empty())
+                merged.push_back(std::move(created));
+        }
+        s.pending.swap(merged);
+    }
+
+    int num_peers;
+    int shards;
+    ShardConfig config;
+    std::vector<std::vector<Link>> links;
+
+    // Coordinator.
+    void *region = nullptr;
+    size_t region_bytes = 0;
+    size_t control_offset = 0, sizes_offset = 0, seeds_offset = 0, digests_offset = 0, totals_offset = 0, demand_offset = 0, rings_offset = 0;
+    size_t attempt_ring_bytes = 0, report_ring_bytes = 0;
+    int capacity = 0;
+    uint64_t generation = 0;
+    std::vector<pid_t> pids;
+    std::vector<ShmRing<Arrival>> reports;
+    std::vector<Arrival> arrivals;
+};
+
+#endif // SHARDED_HPP
@@ -0,0 +1,100 @@
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+#include <atomic>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+/*
+=======================================================================
+  SHARED-MEMORY SPSC RING
+=======================================================================
+
+Bounded single-producer single-consumer ring of trivially copyable
+records laid out in caller-provided memory, so it works between
+processes that share a mapping (MAP_SHARED before fork). The header
+holds the head and tail counters on separate cache lines; both sides
+also keep a private copy of the other side's counter and only reload it
+when the ring looks full (producer) or empty (consumer), so in steady
+streaming each side mostly touches its own line.
+
+try_push / try_pop never block; callers decide how to wait (the sharded
+mode drains its own inbound rings while an outbound one is full, which
+keeps ring cycles between processes from deadlocking).
+*/
+
+template <typename T>
+class ShmRing
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    struct Header
+    {
+        alignas(64) std::atomic<uint64_t> head{0}; // Next slot to pop.
+        alignas(64) std::atomic<uint64_t> tail{0}; // Next slot to push.
+        alignas(64) uint64_t capacity = 0;         // Power of two.
+    };
+
+public:
+    // Bytes needed for a ring of capacity slots (capacity must be a power of two).
+    static constexpr size_t bytes(size_t capacity)
+    {
+        return sizeof(Header) + capacity * sizeof(T);
+    }
+
+    // Lay out an empty ring at memory (64-byte aligned, bytes(capacity) long).
+    static ShmRing create(void *memory, size_t capacity)
+    {
+        Header *h = new (memory) Header{};
+        h->capacity = capacity;
+        return ShmRing(memory);
+    }
+
+    ShmRing() = default;
+
+    // Attach to a ring created at memory (possibly by another process).
+    explicit ShmRing(void *memory)
+        : header(static_cast<Header *>(memory)), slots(reinterpret_cast<T *>(header + 1)), mask(header->capacity - 1)
+    {
+    }
+
+    bool try_push(const T &value)
+    {
+        uint64_t tail = header->tail.load(std::memory_order_relaxed);
+        if (tail - cached_head > mask)
+        {
+            cached_head = header->head.load(std::memory_order_acquire);
+            if (tail - cached_head > mask)
+                return false;
+        }
+        slots[tail & mask] = value;
+        header->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &value)
+    {
+        uint64_t head = header->head.load(std::memory_order_relaxed);
+        if (head == cached_tail)
+        {
+            cached_tail = header->tail.load(std::memory_order_acquire);
+            if (head == cached_tail)
+                return false;
+        }
+        value = slots[head & mask];
+        header->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    Header *header = nullptr;
+    T *slots = nullptr;
+    uint64_t mask = 0;
+    uint64_t cached_head = 0; // Producer's view of head.
+    uint64_t cached_tail = 0; // Consumer's view of tail.
+};
+
+#endif // SHM_RING_HPP
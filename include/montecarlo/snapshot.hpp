@@ -0,0 +1,247 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <print>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+=======================================================================
+  SNAPSHOT FILE FORMAT
+=======================================================================
+
+Container for Network::save_snapshot / load_snapshot. Little-endian:
+
+  header (64 bytes):  "MCSNAP\0\0", uint32 version, uint32 section count,
+                      uint64 file size, zero padding
+  section table:      per section uint32 id, uint32 reserved,
+                      uint64 offset, uint64 size (bytes)
+  sections:           raw fixed-width arrays, each starting on a 64-byte
+                      boundary
+
+Every section is a plain array of fixed-size records, so a mapped file
+can be read in place: SnapshotReader mmaps the file and hands out typed
+views without parsing. Sections with unknown ids are ignored by readers;
+a change to the layout of an existing section bumps the version.
+*/
+
+// SnapshotHeader: First 64 bytes of a snapshot file.
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t file_size;
+    uint8_t reserved[40];
+};
+static_assert(sizeof(SnapshotHeader) == 64);
+
+// SnapshotSection: One section table entry.
+struct SnapshotSection
+{
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+static_assert(sizeof(SnapshotSection) == 24);
+
+constexpr char SNAPSHOT_MAGIC[8] = {'M', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+
+// SnapshotWriter: Collects sections in memory, then writes the file in one pass.
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(uint32_t version) : version(version) {}
+
+    template <typename T>
+    void add(uint32_t id, const std::vector<T> &values)
+    {
+        add_bytes(id, values.data(), values.size() * sizeof(T));
+    }
+
+    void add_bytes(uint32_t id, const void *data, size_t bytes)
+    {
+        const auto *p = static_cast<const uint8_t *>(data);
+        sections.push_back({id, std::vector<uint8_t>(p, p + bytes)});
+    }
+
+    bool write(const std::string &path) const
+    {
+        std::vector<SnapshotSection> table(sections.size());
+        uint64_t offset = align(sizeof(SnapshotHeader) + table.size() * sizeof(SnapshotSection));
+        for (size_t i = 0; i < sections.size(); ++i)
+        {
+            table[i] = {sections[i].id, 0, offset, sections[i].bytes.size()};
+            offset = align(offset + sections[i].bytes.size());
+        }
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = version;
+        header.section_count = static_cast<uint32_t>(sections.size());
+        header.file_size = offset;
+
+        std::FILE *f = std::fopen(path.c_str(), "wb");
+        if (!f)
+        {
+            std::print("Error opening snapshot file {} for writing.\n", path);
+            return false;
+        }
+        bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+                  (table.empty() || std::fwrite(table.data(), sizeof(SnapshotSection), table.size(), f) == table.size());
+        uint64_t written = sizeof(header) + table.size() * sizeof(SnapshotSection);
+        static const uint8_t zeros[64] = {};
+        for (size_t i = 0; ok && i < sections.size(); ++i)
+        {
+            ok = std::fwrite(zeros, 1, table[i].offset - written, f) == table[i].offset - written &&
+                 std::fwrite(sections[i].bytes.data(), 1, sections[i].bytes.size(), f) == sections[i].bytes.size();
+            written = table[i].offset + table[i].size;
+        }
+        ok = ok && std::fwrite(zeros, 1, header.file_size - written, f) == header.file_size - written;
+        ok = (std::fclose(f) == 0) && ok;
+        if (!ok)
+            std::print("Error writing snapshot file {}.\n", path);
+        return ok;
+    }
+
+private:
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + 63) & ~uint64_t{63};
+    }
+
+    struct Section
+    {
+        uint32_t id;
+        std::vector<uint8_t> bytes;
+    };
+
+    uint32_t version;
+    std::vector<Section> sections;
+};
+
+// SnapshotReader: Read-only mapping of a snapshot file with typed section views.
+class SnapshotReader
+{
+public:
+    SnapshotReader() = default;
+    SnapshotReader(const SnapshotReader &) = delete;
+    SnapshotReader &operator=(const SnapshotReader &) = delete;
+    ~SnapshotReader() { close(); }
+
+    bool open(const std::string &path, uint32_t expected_version)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            std::print("Error opening snapshot file {}.\n", path);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotHeader)))
+        {
+            std::print("Error: snapshot file {} is too small.\n", path);
+            ::close(fd);
+            return false;
+        }
+        void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+        {
+            std::print("Error mapping snapshot file {}.\n", path);
+            return false;
+        }
+        base = static_cast<const uint8_t *>(p);
+        length = static_cast<size_t>(st.st_size);
+
+        const auto *header = reinterpret_cast<const SnapshotHeader *>(base);
+        const char *error = nullptr;
+        if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0)
+            error = "not a snapshot file";
+        else if (header->version != expected_version)
+            error = "unsupported snapshot version";
+        else if (header->file_size != length ||
+                 sizeof(SnapshotHeader) + header->section_count * sizeof(SnapshotSection) > length)
+            error = "truncated snapshot file";
+        if (!error)
+        {
+            table = reinterpret_cast<const SnapshotSection *>(base + sizeof(SnapshotHeader));
+            table_size = header->section_count;
+            for (size_t i = 0; i < table_size && !error; ++i)
+                if (table[i].offset % 64 != 0 || table[i].offset > length || table[i].size > length - table[i].offset)
+                    error = "section out of bounds";
+        }
+        if (error)
+        {
+            std::print("Error: {}: {} (version {}).\n", path, error, header->version);
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (base)
+            munmap(const_cast<uint8_t *>(base), length);
+        base = nullptr;
+        length = 0;
+        table = nullptr;
+        table_size = 0;
+    }
+
+    bool has(uint32_t id) const
+    {
+        return find(id) != nullptr;
+    }
+
+    // Typed view of section id: count records of T (0 and nullptr if absent).
+    template <typename T>
+    const T *view(uint32_t id, size_t &count) const
+    {
+        const SnapshotSection *s = find(id);
+        count = s ? s->size / sizeof(T) : 0;
+        return s ? reinterpret_cast<const T *>(base + s->offset) : nullptr;
+    }
+
+    // Number of T records in section id (0 if absent).
+    template <typename T>
+    size_t count(uint32_t id) const
+    {
+        size_t n;
+        view<T>(id, n);
+        return n;
+    }
+
+    template <typename T>
+    std::vector<T> copy(uint32_t id) const
+    {
+        size_t count;
+        const T *p = view<T>(id, count);
+        return std::vector<T>(p, p + count);
+    }
+
+private:
+    const SnapshotSection *find(uint32_t id) const
+    {
+        for (size_t i = 0; i < table_size; ++i)
+            if (table[i].id == id)
+                return &table[i];
+        return nullptr;
+    }
+
+    const uint8_t *base = nullptr;
+    size_t length = 0;
+    const SnapshotSection *table = nullptr;
+    size_t table_size = 0;
+};
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,179 @@
+#ifndef STEADY_STATE_HPP
+#define STEADY_STATE_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+/*
+=======================================================================
+  STEADY-STATE DETECTION
+=======================================================================
+
+Throughput over a whole run includes the start-up transient: the first
+block is proposed from a mempool that is still filling, so short runs
+under-report TPS. The detector is fed the cumulative counters at every
+block publication and looks at the last window_blocks block intervals:
+
+  - rate stability: every interval's published rate (tx/s) is within
+    tolerance of the window mean;
+  - no mempool drift: pending after publication changed by at most
+    tolerance x the mean block size over the window.
+
+The first window that passes marks the end of the warm-up (its first
+block boundary); steady-state throughput is measured from there to the
+last block boundary, so partial blocks at either end are left out.
+Once at least min_steady_blocks intervals are in, the estimate counts as
+converged when the standard error of the per-block rates (batch means)
+is below target_rel_error of their mean; run_experiment can stop there.
+
+A run that never settles (e.g. pending grows every block because
+injection exceeds capacity) reports no steady state.
+*/
+
+// SteadyStateConfig: Detection window, tolerances and early-stop criterion.
+struct SteadyStateConfig
+{
+    int window_blocks = 3;           // Block intervals that must agree.
+    double tolerance = 0.05;         // Relative rate spread / pending drift allowed.
+    bool stop_on_convergence = false; // Let run_experiment stop once converged().
+    int min_steady_blocks = 4;       // Intervals measured after warm-up before converging.
+    double target_rel_error = 0.01;  // Standard error of the steady rate, relative.
+};
+
+class SteadyStateDetector
+{
+public:
+    explicit SteadyStateDetector(const SteadyStateConfig &config = {}) : config(config) {}
+
+    void configure(const SteadyStateConfig &c) { config = c; }
+    const SteadyStateConfig &get_config() const { return config; }
+
+    // Start a run at time_ms with the current cumulative counters.
+    void reset(int time_ms, int64_t published, int64_t published_kb, int64_t pending)
+    {
+        samples.clear();
+        warmup_end = NONE;
+        samples.push_back({time_ms, published, published_kb, pending});
+    }
+
+    // A block was published: counters right after publication at time_ms.
+    void add_block(int time_ms, int64_t published, int64_t published_kb, int64_t pending)
+    {
+        if (!samples.empty() && time_ms <= samples.back().time_ms)
+            return;
+        samples.push_back({time_ms, published, published_kb, pending});
+        if (warmup_end == NONE && window_is_steady())
+            warmup_end = samples.size() - 1 - window();
+    }
+
+    bool steady() const { return warmup_end != NONE; }
+
+    // Steady state found and its rate estimate precise enough to stop.
+    bool converged() const
+    {
+        return steady() && steady_blocks() >= config.min_steady_blocks && relative_error() <= config.target_rel_error;
+    }
+
+    // Time from the start of the run to the end of the warm-up (0 if never steady).
+    int warmup_ms() const
+    {
+        return steady() ? samples[warmup_end].time_ms - samples.front().time_ms : 0;
+    }
+
+    // Block intervals measured after the warm-up.
+    int steady_blocks() const
+    {
+        return steady() ? static_cast<int>(samples.size() - 1 - warmup_end) : 0;
+    }
+
+    // Published tx/s from the end of the warm-up to the last block (0 if never steady).
+    double steady_tps() const
+    {
+        return rate(&Sample::published);
+    }
+
+    double steady_MB_per_sec() const
+    {
+        return rate(&Sample::published_kb) / 1024.0;
+    }
+
+    // Standard error of the mean per-block rate after warm-up, relative to it.
+    double relative_error() const
+    {
+        int n = steady_blocks();
+        if (n < 2)
+            return INFINITY;
+        double sum = 0.0, sum_sq = 0.0;
+        for (size_t i = warmup_end + 1; i < samples.size(); ++i)
+        {
+            double r = interval_rate(i);
+            sum += r;
+            sum_sq += r * r;
+        }
+        double mean = sum / n;
+        if (mean <= 0.0)
+            return INFINITY;
+        double variance = std::max(0.0, (sum_sq - n * mean * mean) / (n - 1));
+        return std::sqrt(variance / n) / mean;
+    }
+
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    struct Sample
+    {
+        int time_ms;
+        int64_t published;
+        int64_t published_kb;
+        int64_t pending;
+    };
+
+    // Published tx/s over the block interval ending at sample i.
+    double interval_rate(size_t i) const
+    {
+        return (samples[i].published - samples[i - 1].published) * 1000.0 /
+               (samples[i].time_ms - samples[i - 1].time_ms);
+    }
+
+    size_t window() const
+    {
+        return static_cast<size_t>(std::max(config.window_blocks, 2));
+    }
+
+    bool window_is_steady() const
+    {
+        size_t w = window();
+        if (samples.size() < w + 1)
+            return false;
+        size_t first = samples.size() - 1 - w;
+        double mean = 0.0;
+        for (size_t i = first + 1; i < samples.size(); ++i)
+            mean += interval_rate(i);
+        mean /= w;
+        if (mean <= 0.0)
+            return false;
+        for (size_t i = first + 1; i < samples.size(); ++i)
+            if (std::abs(interval_rate(i) - mean) > config.tolerance * mean)
+                return false;
+        double block_size = static_cast<double>(samples.back().published - samples[first].published) / w;
+        return std::abs(samples.back().pending - samples[first].pending) <= config.tolerance * block_size;
+    }
+
+    double rate(int64_t Sample::*counter) const
+    {
+        if (!steady() || steady_blocks() == 0)
+            return 0.0;
+        const Sample &a = samples[warmup_end];
+        const Sample &b = samples.back();
+        return (b.*counter - a.*counter) * 1000.0 / (b.time_ms - a.time_ms);
+    }
+
+    SteadyStateConfig config;
+    std::vector<Sample> samples;
+    size_t warmup_end = NONE;
+};
+
+#endif // STEADY_STATE_HPP
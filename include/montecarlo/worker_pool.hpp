@@ -0,0 +1,86 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <barrier>
+#include <functional>
+#include <algorithm>
+
+/*
+=======================================================================
+  WORKER POOL
+=======================================================================
+
+Fixed set of threads that run one job at a time in lockstep: run(job)
+calls job(worker) on every worker, the calling thread being worker 0,
+and returns when all of them are done. Inside a job, sync() is a barrier
+over all workers, so a job can be split into phases that read what the
+previous phase wrote (the barrier orders the memory accesses). Every
+worker must reach the same number of sync() calls.
+
+Threads are started once and park on a barrier between jobs, so a job
+per simulation step costs two barrier rounds, not thread start-ups.
+*/
+
+class WorkerPool
+{
+public:
+    explicit WorkerPool(int threads)
+        : count(std::max(threads, 1)), start(count), done(count), phase(count)
+    {
+        for (int i = 1; i < count; ++i)
+            workers.emplace_back([this, i]
+                                 { loop(i); });
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool()
+    {
+        stopping = true;
+        start.arrive_and_wait();
+        for (auto &t : workers)
+            t.join();
+    }
+
+    int size() const { return count; }
+
+    // Run job(worker) for worker = 0 .. size() - 1; worker 0 on the calling thread.
+    void run(const std::function<void(int)> &job)
+    {
+        current = &job;
+        start.arrive_and_wait();
+        job(0);
+        done.arrive_and_wait();
+        current = nullptr;
+    }
+
+    // Barrier over all workers, for use inside a job.
+    void sync()
+    {
+        phase.arrive_and_wait();
+    }
+
+private:
+    void loop(int worker)
+    {
+        for (;;)
+        {
+            start.arrive_and_wait();
+            if (stopping)
+                return;
+            (*current)(worker);
+            done.arrive_and_wait();
+        }
+    }
+
+    int count;
+    std::barrier<> start, done, phase;
+    std::vector<std::thread> workers;
+    const std::function<void(int)> *current = nullptr;
+    bool stopping = false;
+};
+
+#endif // WORKER_POOL_HPP
@@ -0,0 +1,312 @@
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <numbers>
+#include <cmath>
+#include <cstdint>
+#include <montecarlo/philox.hpp>
+
+/*
+=======================================================================
+  WORKLOAD GENERATORS
+=======================================================================
+
+A Workload decides, for each simulation step, how many transactions
+arrive and where they enter the network. It is split into two parts:
+
+  - ArrivalProcess:   number of arrivals in [start_ms, start_ms + step_ms)
+                      (fixed, Poisson, bursty on/off, diurnal, trace);
+  - SeedDistribution: which peer each arrival is seeded at
+                      (uniform, Zipf, topological hotspot).
+
+Everything is generated lazily, one step at a time, from counter-based
+streams keyed by step start time or tx id. Arbitrary rates therefore
+never materialize more than one step's batch, and the draws do not
+depend on the order in which steps or transactions are processed.
+*/
+
+// InjectionBatch: Sizes and seed peers of a batch of new transactions, stored as
+// contiguous arrays. Entry i becomes transaction id (first id of the batch + i).
+struct InjectionBatch
+{
+    std::vector<int> size_kb; // Size of each transaction.
+    std::vector<int> seed;    // Peer where each transaction enters the network.
+
+    size_t size() const { return size_kb.size(); }
+
+    void resize(size_t n)
+    {
+        size_kb.resize(n);
+        seed.resize(n);
+    }
+};
+
+// WorkloadContext: Network state a workload may draw on when generating a step.
+struct WorkloadContext
+{
+    uint64_t rng_seed;                   // Network seed for counter-based streams.
+    int first_tx_id;                     // Id the first generated transaction will get.
+    int num_peers;                       // Peers in the network (valid seeds are 0 .. num_peers - 1).
+    int tx_size_min;                     // Size range (KB) configured on the network.
+    int tx_size_max;
+    const std::vector<int> &seed_peers;  // Non-validator peers.
+};
+
+// fill_uniform_sizes: Size of tx (first_tx_id + i), uniform in [min_kb, max_kb].
+inline void fill_uniform_sizes(uint64_t rng_seed, int first_tx_id, int n, int min_kb, int max_kb, int *out)
+{
+    counter_fill(rng_seed, RngPurpose::TxSize, static_cast<uint32_t>(first_tx_id), n, [&](int i, uint32_t r)
+                 { out[i] = counter_uniform_int(r, min_kb, max_kb); });
+}
+
+// fill_uniform_seeds: Seed peer of tx (first_tx_id + i), uniform over seed_peers.
+inline void fill_uniform_seeds(uint64_t rng_seed, int first_tx_id, int n, const std::vector<int> &seed_peers, int *out)
+{
+    const int last = static_cast<int>(seed_peers.size()) - 1;
+    counter_fill(rng_seed, RngPurpose::SeedPeer, static_cast<uint32_t>(first_tx_id), n, [&](int i, uint32_t r)
+                 { out[i] = seed_peers[counter_uniform_int(r, 0, last)]; });
+}
+
+// poisson_count: Poisson(mean) draw for the step starting at start_ms.
+inline int poisson_count(uint64_t rng_seed, int start_ms, double mean)
+{
+    if (mean <= 0.0)
+        return 0;
+    CounterRng rng(rng_seed, RngPurpose::Workload, static_cast<uint32_t>(start_ms));
+    return std::poisson_distribution<int>(mean)(rng);
+}
+
+//////////////////////////
+// Arrival Processes
+//////////////////////////
+
+class ArrivalProcess
+{
+public:
+    virtual ~ArrivalProcess() = default;
+    // Number of transactions arriving in [start_ms, start_ms + step_ms).
+    virtual int arrivals(uint64_t rng_seed, int start_ms, int step_ms) = 0;
+};
+
+// FixedArrivals: The same count every step (the classic injection_count).
+class FixedArrivals : public ArrivalProcess
+{
+public:
+    explicit FixedArrivals(int per_step) : per_step(per_step) {}
+
+    int arrivals(uint64_t, int, int) override
+    {
+        return per_step;
+    }
+
+private:
+    int per_step;
+};
+
+// PoissonArrivals: Homogeneous Poisson process with rate_per_ms.
+class PoissonArrivals : public ArrivalProcess
+{
+public:
+    explicit PoissonArrivals(double rate_per_ms) : rate_per_ms(rate_per_ms) {}
+
+    int arrivals(uint64_t rng_seed, int start_ms, int step_ms) override
+    {
+        return poisson_count(rng_seed, start_ms, rate_per_ms * step_ms);
+    }
+
+private:
+    double rate_per_ms;
+};
+
+// BurstyArrivals: Poisson arrivals alternating between on_rate for on_ms and off_rate
+// for off_ms. Steps that straddle a switch get the time-weighted mean.
+class BurstyArrivals : public ArrivalProcess
+{
+public:
+    BurstyArrivals(double on_rate_per_ms, int on_ms, double off_rate_per_ms, int off_ms)
+        : on_rate(on_rate_per_ms), on_ms(on_ms), off_rate(off_rate_per_ms), off_ms(off_ms) {}
+
+    int arrivals(uint64_t rng_seed, int start_ms, int step_ms) override
+    {
+        const int period = on_ms + off_ms;
+        double mean = 0.0;
+        int t = start_ms;
+        const int end = start_ms + step_ms;
+        while (t < end)
+        {
+            int phase = t % period;
+            bool on = phase < on_ms;
+            int segment_end = std::min(end, t - phase + (on ? on_ms : period));
+            mean += (on ? on_rate : off_rate) * (segment_end - t);
+            t = segment_end;
+        }
+        return poisson_count(rng_seed, start_ms, mean);
+    }
+
+private:
+    double on_rate;
+    int on_ms;
+    double off_rate;
+    int off_ms;
+};
+
+// DiurnalArrivals: Poisson arrivals with rate mean * (1 + amplitude * sin(2*pi*(t + phase)/period)).
+class DiurnalArrivals : public ArrivalProcess
+{
+public:
+    DiurnalArrivals(double mean_rate_per_ms, double amplitude, int period_ms, int phase_ms = 0)
+        : mean_rate(mean_rate_per_ms), amplitude(amplitude), period_ms(period_ms), phase_ms(phase_ms) {}
+
+    int arrivals(uint64_t rng_seed, int start_ms, int step_ms) override
+    {
+        // Exact integral of the rate over the step.
+        const double w = 2.0 * std::numbers::pi / period_ms;
+        double t0 = start_ms + phase_ms;
+        double t1 = t0 + step_ms;
+        double mean = mean_rate * (step_ms - amplitude / w * (std::cos(w * t1) - std::cos(w * t0)));
+        return poisson_count(rng_seed, start_ms, mean);
+    }
+
+private:
+    double mean_rate;
+    double amplitude;
+    int period_ms;
+    int phase_ms;
+};
+
+// TraceArrivals: Replays recorded arrival timestamps (ms, sorted ascending).
+class TraceArrivals : public ArrivalProcess
+{
+public:
+    explicit TraceArrivals(std::vector<int> timestamps_ms) : timestamps(std::move(timestamps_ms)) {}
+
+    int arrivals(uint64_t, int start_ms, int step_ms) override
+    {
+        auto lo = std::lower_bound(timestamps.begin(), timestamps.end(), start_ms);
+        auto hi = std::lower_bound(lo, timestamps.end(), start_ms + step_ms);
+        return static_cast<int>(hi - lo);
+    }
+
+private:
+    std::vector<int> timestamps;
+};
+
+//////////////////////////
+// Seed Distributions
+//////////////////////////
+
+class SeedDistribution
+{
+public:
+    virtual ~SeedDistribution() = default;
+    // Seed peer for tx (ctx.first_tx_id + i), written to out[i] for i < n.
+    virtual void assign(const WorkloadContext &ctx, int n, int *out) = 0;
+};
+
+// UniformSeeds: Every non-validator peer equally likely.
+class UniformSeeds : public SeedDistribution
+{
+public:
+    void assign(const WorkloadContext &ctx, int n, int *out) override
+    {
+        fill_uniform_seeds(ctx.rng_seed, ctx.first_tx_id, n, ctx.seed_peers, out);
+    }
+};
+
+// ZipfSeeds: The k-th non-validator peer (in seed_peers order) is chosen with
+// probability proportional to 1 / k^exponent.
+class ZipfSeeds : public SeedDistribution
+{
+public:
+    explicit ZipfSeeds(double exponent) : exponent(exponent) {}
+
+    void assign(const WorkloadContext &ctx, int n, int *out) override
+    {
+        if (cdf.size() != ctx.seed_peers.size())
+        {
+            cdf.resize(ctx.seed_peers.size());
+            double total = 0.0;
+            for (size_t k = 0; k < cdf.size(); ++k)
+                cdf[k] = (total += 1.0 / std::pow(static_cast<double>(k + 1), exponent));
+            for (double &c : cdf)
+                c /= total;
+        }
+        counter_fill(ctx.rng_seed, RngPurpose::SeedPeer, static_cast<uint32_t>(ctx.first_tx_id), n, [&](int i, uint32_t r)
+                     {
+                         size_t k = std::upper_bound(cdf.begin(), cdf.end(), counter_unit(r)) - cdf.begin();
+                         out[i] = ctx.seed_peers[std::min(k, cdf.size() - 1)]; });
+    }
+
+private:
+    double exponent;
+    std::vector<double> cdf;
+};
+
+// HotspotSeeds: A fraction of transactions originates in a hot region (e.g. the
+// peers within a few hops of one peer, see Network::peers_within_hops), the rest
+// uniformly over all non-validator peers.
+class HotspotSeeds : public SeedDistribution
+{
+public:
+    HotspotSeeds(std::vector<int> hot_peers, double hot_fraction)
+        : hot_peers(std::move(hot_peers)), hot_fraction(hot_fraction) {}
+
+    void assign(const WorkloadContext &ctx, int n, int *out) override
+    {
+        const int last_hot = static_cast<int>(hot_peers.size()) - 1;
+        const int last_all = static_cast<int>(ctx.seed_peers.size()) - 1;
+        const uint32_t threshold = static_cast<uint32_t>(hot_fraction * 4294967295.0);
+        counter_fill(ctx.rng_seed, RngPurpose::SeedPeer, static_cast<uint32_t>(ctx.first_tx_id), n, [&](int i, uint32_t r)
+                     {
+                         // One draw picks the region, a second (independent stream) the peer.
+                         uint32_t pick = counter_random(ctx.rng_seed, RngPurpose::Workload, 0, 1, static_cast<uint32_t>(ctx.first_tx_id + i));
+                         if (last_hot >= 0 && r <= threshold)
+                             out[i] = hot_peers[counter_uniform_int(pick, 0, last_hot)];
+                         else
+                             out[i] = ctx.seed_peers[counter_uniform_int(pick, 0, last_all)]; });
+    }
+
+private:
+    std::vector<int> hot_peers;
+    double hot_fraction;
+};
+
+//////////////////////////
+// Workload
+//////////////////////////
+
+class Workload
+{
+public:
+    virtual ~Workload() = default;
+    // Fill batch with the transactions arriving in [start_ms, start_ms + step_ms).
+    virtual void generate(const WorkloadContext &ctx, int start_ms, int step_ms, InjectionBatch &batch) = 0;
+};
+
+// ComposedWorkload: Arrival process + seed distribution; sizes uniform in the network's range.
+class ComposedWorkload : public Workload
+{
+public:
+    ComposedWorkload(std::unique_ptr<ArrivalProcess> arrivals, std::unique_ptr<SeedDistribution> seeds)
+        : arrival_process(std::move(arrivals)), seed_distribution(std::move(seeds)) {}
+
+    void generate(const WorkloadContext &ctx, int start_ms, int step_ms, InjectionBatch &batch) override
+    {
+        int n = ctx.seed_peers.empty() ? 0 : arrival_process->arrivals(ctx.rng_seed, start_ms, step_ms);
+        batch.resize(n);
+        if (n == 0)
+            return;
+        fill_uniform_sizes(ctx.rng_seed, ctx.first_tx_id, n, ctx.tx_size_min, ctx.tx_size_max, batch.size_kb.data());
+        seed_distribution->assign(ctx, n, batch.seed.data());
+    }
+
+private:
+    std::unique_ptr<ArrivalProcess> arrival_process;
+    std::unique_ptr<SeedDistribution> seed_distribution;
+};
+
+#endif // WORKLOAD_HPP
@@ -1,7 +1,11 @@
 #include <print>
 #include <montecarlo/network.hpp>
+#include <montecarlo/arrival_trace.hpp>
 #include <vector>
 #include <fstream>
+#include <memory>
+#include <charconv>
+#include <cstring>
 
 using std::print;
 using std::string;
@@ -10,6 +14,22 @@ using std::string;
 constexpr bool USE_FIXED_SEED = true;
 constexpr unsigned int FIXED_SEED = 12345;
 
+// Event trace: set TRACE_EVENTS to true to write experiment_<n>_trace.json (Chrome trace
+// format, open in ui.perfetto.dev) holding the last TRACE_RING_EVENTS events.
+constexpr bool TRACE_EVENTS = false;
+constexpr size_t TRACE_RING_EVENTS = 1 << 20;
+
+// Steady state: set STOP_ON_STEADY_STATE to true to end an experiment once its steady-state
+// TPS estimate has converged (see steady_state.hpp) instead of running TOTAL_SIMULATION_MS.
+constexpr bool STOP_ON_STEADY_STATE = false;
+
+// Fluid engine: set USE_FLUID_ENGINE to true to run the experiments with the flow-level
+// approximation (see fluid.hpp) instead of the exact engine; for extreme TPS scenarios.
+constexpr bool USE_FLUID_ENGINE = false;
+
+// Broadcast worker threads (see Network::set_threads); results do not depend on it.
+constexpr int THREADS = 1;
+
 // Simulation network parameters.
 constexpr int NUM_PEERS = 30;          // Total number of peers.
 constexpr bool FULL_MESH = false;      // Whether network is fully meshed.
@@ -48,15 +68,62 @@ struct ExperimentParams {
     int max_block_size;
 };
 
-int main() {
+int main(int argc, char **argv) {
+    // montecarlo [--digest] [--shards N] [trace file]
+    // --digest: verification mode; quiet run with FIXED_SEED printing each experiment's golden digest.
+    // --shards N: propagation only, split over N processes pinned to NUMA nodes (see sharded.hpp);
+    //            experiment_results.txt gets the propagation columns instead of the block ones.
+    // trace file: replay a recorded arrival trace instead of fixed injection.
+    bool digest_mode = false;
+    int shards = 0;
+    const char *trace_path = nullptr;
+    for (int a = 1; a < argc; ++a)
+    {
+        string arg = argv[a];
+        if (arg == "--digest")
+            digest_mode = true;
+        else if (arg == "--shards")
+        {
+            // N must be a positive integer; anything else leaves shards at -1 for the usage line.
+            shards = -1;
+            if (a + 1 < argc)
+            {
+                const char *value = argv[++a];
+                const char *value_end = value + std::strlen(value);
+                int n = 0;
+                auto [ptr, ec] = std::from_chars(value, value_end, n);
+                if (ec == std::errc() && ptr == value_end && n > 0)
+                    shards = n;
+            }
+        }
+        else
+            trace_path = argv[a];
+    }
+    if (shards < 0 || (shards > 0 && trace_path))
+    {
+        print("Usage: montecarlo [--digest] [--shards N] [trace file]; --shards takes N > 0 and no trace.\n");
+        return 1;
+    }
+    ArrivalTrace trace;
+    if (trace_path && !trace.open(trace_path))
+        return 1;
+
     Network network;
-    if (USE_FIXED_SEED) {
+    if (USE_FIXED_SEED || digest_mode) {
         network.set_fixed_seed(FIXED_SEED);
     }
+    if (digest_mode) {
+        network.set_verbose(false);
+        network.set_digest_mode(true);
+    }
     
     network.generate_network(NUM_PEERS, FULL_MESH, MIN_CONN, MAX_CONN, DELAY_MIN, DELAY_MAX, DELAY_MULTIPLIER);
     network.select_validators(7); // Randomly select 7 validators.
     network.set_tx_size_config(TX_SIZE_MIN, TX_SIZE_MAX);
+    network.set_threads(THREADS);
+    SteadyStateConfig steady_config;
+    steady_config.stop_on_convergence = STOP_ON_STEADY_STATE && !digest_mode;
+    network.set_steady_state_config(steady_config);
     
     std::vector<ExperimentParams> experiments;
     experiments.push_back(ExperimentParams{
@@ -86,29 +153,17 @@ int main() {
         print("Error opening output file.\n");
         return 1;
     }
-    
-    outfile << "Experiment_ID, NUM_PEERS, FULL_MESH, MIN_CONN, MAX_CONN, DELAY_MIN, DELAY_MAX, DELAY_MULTIPLIER, "
-            << "TOTAL_SIMULATION_MS, INJECTION_COUNT, SIMULATION_STEP_MS, PUBLISH_THRESHOLD, BLOCKTIME, BANDWIDTH_KB_PER_MS, "
-            << "MAX_TRANSACTIONS, MAX_BLOCK_SIZE, TOTAL_PUBLISHED_GLOBAL, TPS, PUBLISHED_MB, MB_PER_SEC, FORCED_PUBLISH_COUNT, FINAL_PENDING_COUNT\n";
-    
-    for (size_t i = 0; i < experiments.size(); i++)
+
+    // Columns every mode writes: the topology and experiment parameters first, then the
+    // propagation latencies, e.g. PEERS90_P50_MS: time for a tx to reach 90% of peers (median).
+    auto write_parameter_header = [&]()
+    {
+        outfile << "Experiment_ID, NUM_PEERS, FULL_MESH, MIN_CONN, MAX_CONN, DELAY_MIN, DELAY_MAX, DELAY_MULTIPLIER, "
+                << "TOTAL_SIMULATION_MS, INJECTION_COUNT, SIMULATION_STEP_MS, PUBLISH_THRESHOLD, BLOCKTIME, BANDWIDTH_KB_PER_MS, "
+                << "MAX_TRANSACTIONS, MAX_BLOCK_SIZE";
+    };
+    auto write_parameters = [&](size_t i, const ExperimentParams &exp)
     {
-        const auto &exp = experiments[i];
-        std::print("--------------------------------------------------\n");
-        std::print("Running experiment {}:\n", i + 1);
-        std::print("TOTAL_SIMULATION_MS: {}\n", exp.total_simulation_ms);
-        std::print("INJECTION_COUNT: {}\n", exp.injection_count);
-        std::print("SIMULATION_STEP_MS: {}\n", exp.simulation_step_ms);
-        std::print("PUBLISH_THRESHOLD: {:.2f}\n", exp.publish_threshold);
-        std::print("BLOCKTIME: {}\n", exp.blocktime);
-        std::print("BANDWIDTH_KB_PER_MS: {:.2f}\n", exp.bandwidth_kb_per_ms);
-        std::print("MAX_TRANSACTIONS: {}\n", exp.max_transactions);
-        std::print("MAX_BLOCK_SIZE: {}\n", exp.max_block_size);
-        
-        auto result = network.run_experiment(exp.total_simulation_ms, exp.injection_count, exp.simulation_step_ms,
-                                               exp.publish_threshold, exp.blocktime, exp.bandwidth_kb_per_ms,
-                                               exp.max_transactions, exp.max_block_size);
-        
         outfile << (i + 1) << ", "
                 << NUM_PEERS << ", "
                 << FULL_MESH << ", "
@@ -124,13 +179,141 @@ int main() {
                 << exp.blocktime << ", "
                 << exp.bandwidth_kb_per_ms << ", "
                 << exp.max_transactions << ", "
-                << exp.max_block_size << ", "
+                << exp.max_block_size;
+    };
+    auto write_coverage_header = [&]()
+    {
+        for (double fraction : Network::COVERAGE_FRACTIONS)
+        {
+            int pct = static_cast<int>(fraction * 100);
+            outfile << ", PEERS" << pct << "_P50_MS, PEERS" << pct << "_P99_MS"
+                    << ", VALIDATORS" << pct << "_P50_MS, VALIDATORS" << pct << "_P99_MS";
+        }
+    };
+    auto write_coverage = [&](const auto &peer_coverage_ms, const auto &validator_coverage_ms)
+    {
+        for (size_t k = 0; k < Network::COVERAGE_FRACTIONS.size(); k++)
+        {
+            outfile << ", " << peer_coverage_ms[k].p50 << ", " << peer_coverage_ms[k].p99
+                    << ", " << validator_coverage_ms[k].p50 << ", " << validator_coverage_ms[k].p99;
+        }
+    };
+
+    if (shards > 0)
+    {
+        write_parameter_header();
+        outfile << ", SHARDS, INJECTED, DELIVERIES, THROTTLED_ATTEMPTS, TRANSMITTED_MB";
+        write_coverage_header();
+        outfile << "\n";
+        ShardConfig shard_config;
+        shard_config.shards = shards;
+        for (size_t i = 0; i < experiments.size(); i++)
+        {
+            const auto &exp = experiments[i];
+            Network::PropagationResult result;
+            if (!network.run_sharded_propagation(exp.total_simulation_ms, exp.injection_count, exp.simulation_step_ms,
+                                                 exp.bandwidth_kb_per_ms, shard_config, result))
+                return 1;
+            std::print("Experiment {} sharded propagation ({} shards): {} txs, {} deliveries, {} throttled attempts, {:.2f} MB transmitted.\n",
+                       i + 1, shards, result.injected, result.deliveries, result.throttled_attempts, result.transmitted_MB);
+            for (size_t k = 0; k < Network::COVERAGE_FRACTIONS.size(); ++k)
+                std::print("  {:>3.0f}% of peers: p50 {} ms, p99 {} ms; of validators: p50 {} ms, p99 {} ms\n",
+                           Network::COVERAGE_FRACTIONS[k] * 100, result.peer_coverage_ms[k].p50,
+                           result.peer_coverage_ms[k].p99, result.validator_coverage_ms[k].p50,
+                           result.validator_coverage_ms[k].p99);
+            write_parameters(i, exp);
+            outfile << ", " << shards << ", " << result.injected << ", " << result.deliveries << ", "
+                    << result.throttled_attempts << ", " << result.transmitted_MB;
+            write_coverage(result.peer_coverage_ms, result.validator_coverage_ms);
+            outfile << "\n";
+        }
+        outfile.close();
+        return 0;
+    }
+
+    write_parameter_header();
+    outfile << ", TOTAL_PUBLISHED_GLOBAL, TPS, PUBLISHED_MB, MB_PER_SEC, FORCED_PUBLISH_COUNT, FINAL_PENDING_COUNT";
+    write_coverage_header();
+    outfile << ", INCLUSION_P50_MS, INCLUSION_P90_MS, INCLUSION_P99_MS";
+    outfile << ", STEADY_STATE, WARMUP_MS, STEADY_BLOCKS, STEADY_TPS, STEADY_MB_PER_SEC";
+    for (const char *phase : PHASE_NAMES)
+        outfile << ", " << phase << "_SEC, " << phase << "_CALLS, " << phase << "_ITEMS";
+    outfile << "\n";
+    
+    for (size_t i = 0; i < experiments.size(); i++)
+    {
+        const auto &exp = experiments[i];
+        std::print("--------------------------------------------------\n");
+        std::print("Running experiment {}:\n", i + 1);
+        std::print("TOTAL_SIMULATION_MS: {}\n", exp.total_simulation_ms);
+        std::print("INJECTION_COUNT: {}\n", exp.injection_count);
+        std::print("SIMULATION_STEP_MS: {}\n", exp.simulation_step_ms);
+        std::print("PUBLISH_THRESHOLD: {:.2f}\n", exp.publish_threshold);
+        std::print("BLOCKTIME: {}\n", exp.blocktime);
+        std::print("BANDWIDTH_KB_PER_MS: {:.2f}\n", exp.bandwidth_kb_per_ms);
+        std::print("MAX_TRANSACTIONS: {}\n", exp.max_transactions);
+        std::print("MAX_BLOCK_SIZE: {}\n", exp.max_block_size);
+
+        // Per-step time series for this experiment.
+        MetricsSink steps;
+        if (steps.open("experiment_" + std::to_string(i + 1) + "_steps.csv", MetricsSink::Format::CSV))
+            network.set_metrics_sink(&steps);
+        std::unique_ptr<EventTracer> tracer;
+        if (TRACE_EVENTS)
+        {
+            tracer = std::make_unique<EventTracer>(TRACE_RING_EVENTS);
+            network.set_event_tracer(tracer.get());
+        }
+        
+        Network::ExperimentResult result;
+        if (trace.is_open())
+        {
+            std::print("Replaying arrival trace {} ({} transactions).\n", trace_path, trace.count());
+            TraceWorkload workload(trace);
+            result = network.run_experiment(workload, exp.total_simulation_ms, exp.simulation_step_ms,
+                                            exp.publish_threshold, exp.blocktime, exp.bandwidth_kb_per_ms,
+                                            exp.max_transactions, exp.max_block_size);
+            if (!workload.ok())
+                return 1;
+        }
+        else if (USE_FLUID_ENGINE && !digest_mode)
+        {
+            result = network.run_fluid_experiment(exp.total_simulation_ms, exp.injection_count, exp.simulation_step_ms,
+                                                  exp.publish_threshold, exp.blocktime, exp.bandwidth_kb_per_ms,
+                                                  exp.max_transactions, exp.max_block_size);
+        }
+        else
+        {
+            result = network.run_experiment(exp.total_simulation_ms, exp.injection_count, exp.simulation_step_ms,
+                                            exp.publish_threshold, exp.blocktime, exp.bandwidth_kb_per_ms,
+                                            exp.max_transactions, exp.max_block_size);
+        }
+        
+        network.set_metrics_sink(nullptr);
+        steps.close();
+        if (digest_mode)
+            std::print("Experiment {} digest: {:016x}\n", i + 1, result.digest);
+        if (tracer)
+        {
+            network.set_event_tracer(nullptr);
+            tracer->write_json("experiment_" + std::to_string(i + 1) + "_trace.json");
+        }
+
+        write_parameters(i, exp);
+        outfile << ", "
                 << result.total_published_global << ", "
                 << result.tps << ", "
                 << result.published_MB << ", "
                 << result.MB_per_sec << ", "
                 << result.forced_publish_count << ", "
-                << result.final_pending_count << "\n";
+                << result.final_pending_count;
+        write_coverage(result.peer_coverage_ms, result.validator_coverage_ms);
+        outfile << ", " << result.inclusion_ms.p50 << ", " << result.inclusion_ms.p90 << ", " << result.inclusion_ms.p99;
+        outfile << ", " << result.steady_state << ", " << result.warmup_ms << ", " << result.steady_blocks
+                << ", " << result.steady_tps << ", " << result.steady_MB_per_sec;
+        for (const auto &phase : result.phases)
+            outfile << ", " << phase.seconds << ", " << phase.calls << ", " << phase.items;
+        outfile << "\n";
     }
     
     outfile.close();
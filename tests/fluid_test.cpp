@@ -0,0 +1,77 @@
+#include <catch2/catch_test_macros.hpp>
+#include "test_network.hpp"
+#include <cmath>
+
+/*
+=======================================================================
+  FLUID MODEL TESTS
+=======================================================================
+
+Calibration of the fluid model against the exact engine on the small
+golden topology, with and without a bandwidth limit, with one and with
+several seed peers per origin group, and a check that neither the fluid
+run nor the calibration changes the network.
+*/
+
+namespace
+{
+    Network::FluidCalibration calibrate(const Network &net, double bandwidth_kb_per_ms, const FluidConfig &config = {})
+    {
+        return net.calibrate_fluid(60000, 2000, 1000, 95.0, 15000, bandwidth_kb_per_ms, 45000, 135000, config);
+    }
+}
+
+TEST_CASE("Fluid model matches the exact engine without throttling", "[fluid]")
+{
+    Network net;
+    build_test_network(net);
+    auto c = calibrate(net, 1000.0);
+    CHECK(std::abs(c.tps_error) < 0.01);
+    CHECK(std::abs(c.pending_error) < 0.01);
+    CHECK(c.fluid.forced_publish_count == c.exact.forced_publish_count);
+    CHECK(c.fluid.peer_coverage_ms[0].count > 0);
+}
+
+TEST_CASE("Fluid model tracks the exact engine under a bandwidth limit", "[fluid]")
+{
+    Network net;
+    build_test_network(net);
+    auto c = calibrate(net, 0.5);
+    CHECK(std::abs(c.tps_error) < 0.05);
+    CHECK(std::abs(c.pending_error) < 0.05);
+}
+
+TEST_CASE("Fluid model with several seeds per origin group", "[fluid]")
+{
+    // 23 seed peers in 4 groups: known fractions are fractional, so a link that resent what
+    // its sender already offered would show up as early coverage and extra TPS.
+    Network net;
+    build_test_network(net);
+    FluidConfig config;
+    config.origin_groups = 4;
+    auto c = calibrate(net, 1000.0, config);
+    CHECK(std::abs(c.tps_error) < 0.01);
+    CHECK(std::abs(c.pending_error) < 0.01);
+    for (size_t k = 0; k < Network::COVERAGE_FRACTIONS.size(); ++k)
+    {
+        CHECK(std::abs(static_cast<double>(c.fluid.peer_coverage_ms[k].p50) - c.exact.peer_coverage_ms[k].p50) < 250);
+        CHECK(std::abs(static_cast<double>(c.fluid.validator_coverage_ms[k].p50) - c.exact.validator_coverage_ms[k].p50) < 250);
+    }
+
+    auto throttled = calibrate(net, 0.5, config);
+    CHECK(std::abs(throttled.tps_error) < 0.05);
+    CHECK(std::abs(throttled.pending_error) < 0.05);
+}
+
+TEST_CASE("Fluid runs leave the network unchanged", "[fluid]")
+{
+    Network reference;
+    build_test_network(reference);
+    auto expected = reference.run_experiment(20000, 2000, 1000, 95.0, 15000, 1000.0, 45000, 135000);
+
+    Network net;
+    build_test_network(net);
+    net.run_fluid_experiment(20000, 2000, 1000, 95.0, 15000, 1000.0, 45000, 135000);
+    calibrate(net, 0.5);
+    CHECK(net.run_experiment(20000, 2000, 1000, 95.0, 15000, 1000.0, 45000, 135000).digest == expected.digest);
+}
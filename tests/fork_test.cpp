@@ -0,0 +1,49 @@
+#include <catch2/catch_test_macros.hpp>
+#include "test_network.hpp"
+
+/*
+=======================================================================
+  FORK TESTS
+=======================================================================
+
+A fork shares the parent's state copy-on-write: run with the same
+parameters it must produce the same digest as the parent, and nothing
+the fork does may leak back into the parent.
+*/
+
+namespace
+{
+    Network::ExperimentResult run(Network &net, int injection_count, double bandwidth_kb_per_ms)
+    {
+        return net.run_experiment(20000, injection_count, 1000, 95.0, 15000, bandwidth_kb_per_ms, 45000, 135000, false);
+    }
+}
+
+TEST_CASE("Fork continues like its parent", "[fork]")
+{
+    Network parent;
+    build_test_network(parent);
+    run(parent, 2000, 1000.0);
+
+    Network child = parent.fork();
+    auto from_child = run(child, 2000, 1000.0);
+    auto from_parent = run(parent, 2000, 1000.0);
+    CHECK(from_child.total_published_global == from_parent.total_published_global);
+    CHECK(from_child.digest == from_parent.digest);
+}
+
+TEST_CASE("Fork does not change its parent", "[fork]")
+{
+    Network reference;
+    build_test_network(reference);
+    run(reference, 2000, 1000.0);
+    auto expected = run(reference, 2000, 1000.0);
+
+    Network parent;
+    build_test_network(parent);
+    run(parent, 2000, 1000.0);
+    Network child = parent.fork();
+    CHECK(child.known_memory_bytes(true) < parent.known_memory_bytes() / 10);
+    run(child, 3000, 0.5);
+    CHECK(run(parent, 2000, 1000.0).digest == expected.digest);
+}
@@ -0,0 +1,117 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include "test_network.hpp"
+
+/*
+=======================================================================
+  GOLDEN DIGEST TESTS
+=======================================================================
+
+Runs fixed-seed scenarios in digest mode and checks that every engine
+variant reproduces the reference digest (per-step pending and published
+counts plus final known sets) bit for bit. GOLDEN_* pin the reference
+itself, so a change that alters results in every engine at once is
+caught too. They depend on the standard library's random distributions
+(libstdc++); if results change on purpose, update them from the failing
+check's output and say why in the commit.
+
+New engines (alternative broadcast or known storage implementations)
+are added as further cases comparing against the reference run.
+*/
+
+namespace
+{
+    // Scenario: Topology size and run_experiment arguments.
+    struct Scenario
+    {
+        int peers;
+        int injection_count;
+        double publish_threshold;
+        int blocktime;
+        double bandwidth_kb_per_ms;
+    };
+
+    // Unthrottled, publishing on coverage.
+    constexpr Scenario STEADY{30, 2000, 95.0, 15000, 1000.0};
+    // Bandwidth-bound with an unreachable threshold: throttled attempts and forced publishes.
+    constexpr Scenario THROTTLED{30, 2000, 100.0, 3000, 0.3};
+
+    constexpr uint64_t GOLDEN_STEADY = 0x1f72be6d60ba564eULL;
+    constexpr uint64_t GOLDEN_THROTTLED = 0x5104bf3a45415352ULL;
+
+    Network::ExperimentResult run(const Scenario &sc, unsigned int seed = FIXED_SEED,
+                                  BroadcastMode mode = BroadcastMode::Reference, int threads = 1)
+    {
+        Network net;
+        net.set_threads(threads);
+        net.set_broadcast_mode(mode);
+        build_test_network(net, seed, sc.peers);
+        int max_transactions = sc.injection_count * 15 * 3 / 2;
+        return net.run_experiment(30000, sc.injection_count, 1000, sc.publish_threshold, sc.blocktime,
+                                  sc.bandwidth_kb_per_ms, max_transactions, max_transactions * 3);
+    }
+
+    // Restores the default popcount kernel when a test case ends.
+    struct KernelGuard
+    {
+        ~KernelGuard() { select_popcount_kernel(PopcountKernel::Auto); }
+    };
+}
+
+TEST_CASE("Reference engine matches the golden digests", "[digest]")
+{
+    CHECK(run(STEADY).digest == GOLDEN_STEADY);
+    CHECK(run(THROTTLED).digest == GOLDEN_THROTTLED);
+}
+
+TEST_CASE("Digest is deterministic and sensitive to the run", "[digest]")
+{
+    auto first = run(STEADY);
+    auto second = run(STEADY);
+    CHECK(first.digest == second.digest);
+    CHECK(run(STEADY, FIXED_SEED + 1).digest != first.digest);
+}
+
+TEST_CASE("Popcount kernels match the portable reference", "[digest][engine]")
+{
+    KernelGuard guard;
+    auto kernel = GENERATE(PopcountKernel::AVX2, PopcountKernel::AVX512);
+    auto scenario = GENERATE(STEADY, THROTTLED);
+
+    select_popcount_kernel(PopcountKernel::Portable);
+    uint64_t reference = run(scenario).digest;
+
+    select_popcount_kernel(kernel);
+    if (active_popcount_kernel() != kernel)
+        SKIP(popcount_kernel_name(kernel) << " is not supported on this CPU");
+    CHECK(run(scenario).digest == reference);
+}
+
+TEST_CASE("Lazy broadcast matches the reference when unthrottled", "[digest][engine]")
+{
+    CHECK(run(STEADY, FIXED_SEED, BroadcastMode::Lazy).digest == GOLDEN_STEADY);
+}
+
+TEST_CASE("Analytic propagation matches the reference", "[digest][engine]")
+{
+    // THROTTLED binds bandwidth from the first step, so it checks the switch to attempts.
+    CHECK(run(STEADY, FIXED_SEED, BroadcastMode::Analytic).digest == GOLDEN_STEADY);
+    CHECK(run(THROTTLED, FIXED_SEED, BroadcastMode::Analytic).digest == GOLDEN_THROTTLED);
+}
+
+TEST_CASE("Cohort propagation matches the reference", "[digest][engine]")
+{
+    // THROTTLED splits the cohorts into single txs in its first step.
+    CHECK(run(STEADY, FIXED_SEED, BroadcastMode::Cohort).digest == GOLDEN_STEADY);
+    CHECK(run(THROTTLED, FIXED_SEED, BroadcastMode::Cohort).digest == GOLDEN_THROTTLED);
+}
+
+TEST_CASE("Parallel broadcast matches the reference", "[digest][engine]")
+{
+    // THROTTLED runs its first steps in parallel, then falls back once senders hit their limit.
+    for (int threads : {2, 3, 8})
+    {
+        CHECK(run(STEADY, FIXED_SEED, BroadcastMode::Reference, threads).digest == GOLDEN_STEADY);
+        CHECK(run(THROTTLED, FIXED_SEED, BroadcastMode::Reference, threads).digest == GOLDEN_THROTTLED);
+    }
+}
@@ -0,0 +1,100 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include "test_network.hpp"
+#include <montecarlo/numa.hpp>
+
+/*
+=======================================================================
+  SHARDED PROPAGATION TESTS
+=======================================================================
+
+Known sets of the multi-process sharded mode against the single-process
+engine on the small golden topology: unthrottled, with a publish
+threshold no validator can meet and a blocktime past the end of the run
+so nothing is published. Throttled, the shards split each sender's
+budget, so only the totals are compared with the engine stepped on its
+own. The bounds are the ones sharded.hpp documents: deliveries within 3%
+and throttled attempts within 5%. Also the sysfs cpulist parser used for
+NUMA pinning.
+*/
+
+namespace
+{
+    constexpr int TOTAL_MS = 20000;
+    constexpr int INJECTION_COUNT = 2000;
+    constexpr int STEP_MS = 1000;
+    constexpr double BANDWIDTH = 1000.0;
+    constexpr double THROTTLED_BANDWIDTH = 0.5;
+    constexpr double MAX_DELIVERY_ERROR = 0.03;
+    constexpr double MAX_THROTTLED_ERROR = 0.05;
+
+    double relative_error(int64_t value, int64_t expected)
+    {
+        return std::abs(static_cast<double>(value - expected)) / static_cast<double>(expected);
+    }
+}
+
+TEST_CASE("Sharded propagation reproduces the single-process known sets", "[sharded]")
+{
+    Network reference;
+    build_test_network(reference);
+    auto expected = reference.run_experiment(TOTAL_MS, INJECTION_COUNT, STEP_MS, 101.0, 2 * TOTAL_MS, BANDWIDTH, 45000, 135000);
+    REQUIRE(expected.total_published_global == 0);
+
+    for (int shards : {1, 2, 3})
+    {
+        Network net;
+        build_test_network(net);
+        ShardConfig config;
+        config.shards = shards;
+        config.ring_slots = 1 << 10; // Small rings, so full-ring handling is exercised.
+        Network::PropagationResult result;
+        REQUIRE(net.run_sharded_propagation(TOTAL_MS, INJECTION_COUNT, STEP_MS, BANDWIDTH, config, result));
+        CHECK(result.injected == expected.final_pending_count);
+        CHECK(result.throttled_attempts == 0);
+        REQUIRE(result.known_digest.size() == TEST_PEERS);
+        for (int p = 0; p < TEST_PEERS; ++p)
+            CHECK(result.known_digest[p] == reference.known_digest(p));
+        for (size_t k = 0; k < result.peer_coverage_ms.size(); ++k)
+            CHECK(result.peer_coverage_ms[k].count == expected.peer_coverage_ms[k].count);
+    }
+}
+
+TEST_CASE("Sharded propagation shares each sender's budget across shards", "[sharded]")
+{
+    // Reference: the same workload and steps as run_sharded_propagation, no blocks.
+    Network reference;
+    build_test_network(reference);
+    reference.clean_network_txs();
+    ComposedWorkload workload(std::make_unique<FixedArrivals>(INJECTION_COUNT), std::make_unique<UniformSeeds>());
+    int64_t deliveries = 0, throttled = 0;
+    for (int t = 0; t < TOTAL_MS; t += STEP_MS)
+    {
+        reference.inject_workload(workload, t, STEP_MS);
+        reference.broadcast(STEP_MS, THROTTLED_BANDWIDTH);
+        StepMetrics m = reference.current_step_metrics(t + STEP_MS);
+        deliveries += m.deliveries;
+        throttled += m.throttled_attempts;
+    }
+    REQUIRE(throttled > 0);
+
+    for (int shards : {1, 2, 3})
+    {
+        Network net;
+        build_test_network(net);
+        ShardConfig config;
+        config.shards = shards;
+        Network::PropagationResult result;
+        REQUIRE(net.run_sharded_propagation(TOTAL_MS, INJECTION_COUNT, STEP_MS, THROTTLED_BANDWIDTH, config, result));
+        CHECK(relative_error(result.deliveries, deliveries) < MAX_DELIVERY_ERROR);
+        CHECK(relative_error(result.throttled_attempts, throttled) < MAX_THROTTLED_ERROR);
+    }
+}
+
+TEST_CASE("cpulist parsing", "[sharded]")
+{
+    CHECK(parse_cpu_list("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    CHECK(parse_cpu_list("5") == std::vector<int>{5});
+    CHECK(parse_cpu_list("").empty());
+    CHECK(parse_cpu_list("x-2").empty());
+}
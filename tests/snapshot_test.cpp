@@ -0,0 +1,118 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <string>
+#include "test_network.hpp"
+
+/*
+=======================================================================
+  SNAPSHOT TESTS
+=======================================================================
+
+A network restored from a snapshot must continue exactly like the
+network that wrote it: both runs after the snapshot point produce the
+same digest. Damaged files are rejected before the network changes.
+*/
+
+namespace
+{
+    Network::ExperimentResult run(Network &net, bool reset_state)
+    {
+        return net.run_experiment(20000, 2000, 1000, 95.0, 15000, 1000.0, 45000, 135000, reset_state);
+    }
+
+    // Section id of the attempt table in the version 1 format (Network::SNAP_ATTEMPTS).
+    constexpr uint32_t SNAP_ATTEMPTS = 14;
+
+    std::string temp_path(const char *name)
+    {
+        return std::string(P_tmpdir) + "/montecarlo_" + name;
+    }
+
+    // Overwrite the start of section id in the snapshot at path. False if the section is
+    // missing or shorter than size.
+    bool patch_section(const std::string &path, uint32_t id, const void *bytes, size_t size)
+    {
+        std::FILE *f = std::fopen(path.c_str(), "r+b");
+        if (!f)
+            return false;
+        SnapshotHeader header;
+        bool ok = false;
+        if (std::fread(&header, sizeof(header), 1, f) == 1)
+        {
+            for (uint32_t i = 0; i < header.section_count; ++i)
+            {
+                SnapshotSection section;
+                if (std::fread(&section, sizeof(section), 1, f) != 1)
+                    break;
+                if (section.id != id || section.size < size)
+                    continue;
+                ok = std::fseek(f, static_cast<long>(section.offset), SEEK_SET) == 0 && std::fwrite(bytes, size, 1, f) == 1;
+                break;
+            }
+        }
+        return std::fclose(f) == 0 && ok;
+    }
+}
+
+TEST_CASE("Restored network continues like the original", "[snapshot]")
+{
+    const std::string path = temp_path("snapshot_test.snap");
+    Network original;
+    build_test_network(original);
+    run(original, true);
+    REQUIRE(original.save_snapshot(path));
+    auto expected = run(original, false);
+
+    Network restored;
+    restored.set_verbose(false);
+    restored.set_digest_mode(true);
+    REQUIRE(restored.load_snapshot(path));
+    auto actual = run(restored, false);
+    std::remove(path.c_str());
+
+    CHECK(actual.total_published_global == expected.total_published_global);
+    CHECK(actual.final_pending_count == expected.final_pending_count);
+    CHECK(actual.digest == expected.digest);
+}
+
+TEST_CASE("Snapshot loading rejects bad files and keeps the network", "[snapshot]")
+{
+    const std::string path = temp_path("snapshot_bad.snap");
+    Network net;
+    build_test_network(net);
+    REQUIRE(net.save_snapshot(path));
+
+    // Bump the version field.
+    std::FILE *f = std::fopen(path.c_str(), "r+b");
+    REQUIRE(f);
+    uint32_t version = 999;
+    std::fseek(f, 8, SEEK_SET);
+    std::fwrite(&version, sizeof(version), 1, f);
+    std::fclose(f);
+
+    Network other;
+    other.set_verbose(false);
+    CHECK_FALSE(other.load_snapshot(path));
+    CHECK(other.get_num_peers() == 0);
+    CHECK_FALSE(other.load_snapshot(temp_path("does_not_exist.snap")));
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Snapshot loading rejects attempts to peers that do not exist", "[snapshot]")
+{
+    const std::string path = temp_path("snapshot_bad_attempt.snap");
+    Network net;
+    build_test_network(net);
+    // Throttled and stopped mid-run, so attempts are still in flight.
+    net.run_experiment(5000, 2000, 1000, 95.0, 15000, 0.3, 45000, 135000);
+    REQUIRE(net.save_snapshot(path));
+
+    const int32_t peers[2] = {1 << 24, 1 << 24}; // Sender and receiver of the first attempt.
+    REQUIRE(patch_section(path, SNAP_ATTEMPTS, peers, sizeof(peers)));
+
+    Network other;
+    other.set_verbose(false);
+    CHECK_FALSE(other.load_snapshot(path));
+    CHECK(other.get_num_peers() == 0);
+    std::remove(path.c_str());
+}
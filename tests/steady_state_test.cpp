@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+#include <montecarlo/steady_state.hpp>
+
+/*
+=======================================================================
+  STEADY-STATE DETECTOR TESTS
+=======================================================================
+
+Synthetic block sequences: a slow first block followed by steady ones,
+a mempool that grows every block, and early-stop convergence.
+*/
+
+namespace
+{
+    // Feed blocks of the given sizes every 15 s, pending after each block as given.
+    void feed(SteadyStateDetector &d, const std::vector<int64_t> &blocks, const std::vector<int64_t> &pending)
+    {
+        d.reset(0, 0, 0, 0);
+        int64_t published = 0;
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            published += blocks[i];
+            d.add_block(static_cast<int>(i + 1) * 15000, published, published * 3, pending[i]);
+        }
+    }
+}
+
+TEST_CASE("Warm-up block is trimmed", "[steady]")
+{
+    SteadyStateDetector d;
+    feed(d, {10000, 30000, 30000, 30000, 30000}, {1000, 1000, 1000, 1000, 1000});
+    REQUIRE(d.steady());
+    CHECK(d.warmup_ms() == 15000);
+    CHECK(d.steady_blocks() == 4);
+    CHECK(d.steady_tps() == 2000.0);
+    CHECK(d.steady_MB_per_sec() == 2000.0 * 3 / 1024.0);
+}
+
+TEST_CASE("Growing mempool is not steady", "[steady]")
+{
+    SteadyStateDetector d;
+    feed(d, {30000, 30000, 30000, 30000, 30000}, {10000, 20000, 30000, 40000, 50000});
+    CHECK_FALSE(d.steady());
+    CHECK(d.steady_tps() == 0.0);
+}
+
+TEST_CASE("Converges once enough steady blocks are in", "[steady]")
+{
+    SteadyStateConfig config;
+    config.min_steady_blocks = 4;
+    SteadyStateDetector d(config);
+    feed(d, {10000, 30000, 30100, 29900}, {1000, 1000, 1000, 1000});
+    CHECK(d.steady());
+    CHECK_FALSE(d.converged());
+    feed(d, {10000, 30000, 30100, 29900, 30000}, {1000, 1000, 1000, 1000, 1000});
+    CHECK(d.converged());
+}
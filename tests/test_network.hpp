@@ -0,0 +1,31 @@
+#ifndef TEST_NETWORK_HPP
+#define TEST_NETWORK_HPP
+
+#include <montecarlo/network.hpp>
+
+/*
+=======================================================================
+  TEST NETWORK
+=======================================================================
+
+The small fixed-seed network the engine tests run on: 30 peers with 3
+to 12 connections, 10-500 ms delays, 7 validators and 1-5 KB txs. The
+golden digests are pinned to it, so tests build it here rather than
+repeating the constants.
+*/
+
+constexpr unsigned int FIXED_SEED = 12345;
+constexpr int TEST_PEERS = 30;
+
+// build_test_network: Quiet, digest-mode network with the test topology.
+inline void build_test_network(Network &net, unsigned int seed = FIXED_SEED, int peers = TEST_PEERS)
+{
+    net.set_verbose(false);
+    net.set_digest_mode(true);
+    net.set_fixed_seed(seed);
+    net.generate_network(peers, false, 3, 12, 10, 500, 1);
+    net.select_validators(7);
+    net.set_tx_size_config(1, 5);
+}
+
+#endif // TEST_NETWORK_HPP